@@ -0,0 +1,194 @@
+#pragma once
+#include "ProfileCache.h"
+#include <queue>
+#include <chrono>
+#define ANYTIME_TIME_LIMIT 1000.0
+#define ANYTIME_WEIGHT_STEP 0.25f
+
+// ARA*: weighted A* run over & over with a falling weight, each pass reusing the last one's g values & only
+// re-expanding tiles whose g has dropped since. Runs in time slices, & each finished pass hands back its path with
+// the bound it's proven to be within.
+struct AnytimeSearch
+{
+    enum State : uint8_t
+    {
+        UNSEEN,     // Not on the open list, & not expanded this pass
+        OPEN,
+        CLOSED,     // Expanded this pass
+        INCONS      // Expanded this pass, then found a cheaper way to
+    };
+
+    void Reset(Cell start, Cell goal, const ProfileCache& profile, bool manhattan, int agentSize, float weight)
+    {
+        this->start = start;
+        this->goal = goal;
+        this->profile = &profile;
+        this->manhattan = manhattan;
+        this->agentSize = agentSize;
+        epsilon = max(weight, 1.0f);
+        g.assign(TILE_COUNT * TILE_COUNT, FLT_MAX);
+        keys.assign(TILE_COUNT * TILE_COUNT, FLT_MAX);
+        parents.assign(TILE_COUNT * TILE_COUNT, uint32_t(Index(start)));
+        states.assign(TILE_COUNT * TILE_COUNT, UNSEEN);
+        openList = {};
+        pass = {};
+        milliseconds = 0.0;
+
+        running = profile.Connected(start, goal) && (agentSize == 1 || profile.clearance.Fits(start, agentSize));
+        if (running)
+        {
+            g[Index(start)] = 0.0f;
+            Open(Index(start));
+        }
+    }
+
+    bool Running() const
+    {
+        return running;
+    }
+
+    void Stop()
+    {
+        running = false;
+    }
+
+    // Searches for up to budget milliseconds. Returns true once a pass finishes, with its path & stats; a path that
+    // turns out not to exist (too narrow for the agent) comes back empty & ends the search.
+    bool Improve(double budget, vector<Cell>& path, SearchStats& stats)
+    {
+        if (!running) return false;
+
+        const auto startTime = chrono::steady_clock::now();
+        const size_t startBytes = gBytesAllocated;
+        const size_t goalIndex = Index(goal);
+        bool finished = false;
+        for (size_t i = 0; ; i++)
+        {
+            while (!openList.empty() && (states[openList.top().second] != OPEN || openList.top().first != keys[openList.top().second]))
+            {
+                openList.pop();
+                pass.stalePops++;
+            }
+            if (openList.empty() || g[goalIndex] <= openList.top().first)
+            {
+                finished = true;
+                break;
+            }
+            if (i % 64 == 63 && chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count() > budget)
+                break;
+
+            const uint32_t index = openList.top().second;
+            openList.pop();
+            states[index] = CLOSED;
+            pass.expanded++;
+            Expand(index);
+        }
+
+        const double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        milliseconds += elapsed;
+        pass.milliseconds += elapsed;
+        pass.bytesAllocated += gBytesAllocated - startBytes;
+        if (!finished) return false;
+
+        path.clear();
+        if (g[goalIndex] == FLT_MAX)
+        {
+            running = false;
+            stats = pass;
+            return true;
+        }
+
+        // Nothing still to expand can reach the goal for less than the cheapest f on the open & inconsistent lists
+        float lowest = FLT_MAX;
+        for (size_t index = 0; index < states.size(); index++)
+        {
+            if (states[index] == OPEN || states[index] == INCONS)
+                lowest = min(lowest, g[index] + Heuristic(index));
+        }
+        const float bound = lowest >= g[goalIndex] ? 1.0f : min(epsilon, g[goalIndex] / lowest);
+
+        for (uint32_t index = uint32_t(goalIndex); ; index = parents[index])
+        {
+            path.push_back({ int(index % TILE_COUNT), int(index / TILE_COUNT) });
+            if (index == Index(start) || path.size() > TILE_COUNT * TILE_COUNT) break;
+        }
+        reverse(path.begin(), path.end());
+
+        pass.bound = bound;
+        stats = pass;
+        pass = {};
+
+        // The time limit only applies once there's a path. Otherwise lower the weight for the next pass, moving tiles that
+        // got cheaper after expansion back onto the open list.
+        if (bound <= 1.0f || milliseconds > ANYTIME_TIME_LIMIT)
+        {
+            running = false;
+            return true;
+        }
+        epsilon = max(1.0f, epsilon - ANYTIME_WEIGHT_STEP);
+        openList = {};
+        for (uint32_t index = 0; index < states.size(); index++)
+        {
+            if (states[index] == OPEN || states[index] == INCONS)
+                Open(index);
+            else if (states[index] == CLOSED)
+                states[index] = UNSEEN;
+        }
+        return true;
+    }
+
+    float Heuristic(size_t index) const
+    {
+        const Cell cell{ int(index % TILE_COUNT), int(index / TILE_COUNT) };
+        const float remaining = manhattan ? Manhattan(cell, goal) : Euclidean(cell, goal);
+        return remaining + Chebyshev(cell, goal) * profile->minCost;
+    }
+
+    void Open(uint32_t index)
+    {
+        keys[index] = g[index] + epsilon * Heuristic(index);
+        states[index] = OPEN;
+        openList.push({ keys[index], index });
+        pass.pushed++;
+        pass.peakOpen = max(pass.peakOpen, openList.size());
+    }
+
+    void Expand(uint32_t index)
+    {
+        const Cell cell{ int(index % TILE_COUNT), int(index / TILE_COUNT) };
+        for (const Cell& neighbour : Neighbours(cell))
+        {
+            if (agentSize > 1 && !profile->clearance.Fits(cell, neighbour, agentSize)) continue;
+            const uint32_t neighbourIndex = uint32_t(Index(neighbour));
+            const float terrain = profile->tileCosts[neighbourIndex];
+            if (terrain == IMPASSABLE) continue;
+
+            const float distance = manhattan ? Manhattan(cell, neighbour) : Euclidean(cell, neighbour);
+            const float gNew = g[index] + distance + terrain;
+            if (gNew >= g[neighbourIndex]) continue;
+
+            g[neighbourIndex] = gNew;
+            parents[neighbourIndex] = index;
+            if (states[neighbourIndex] == CLOSED)
+                states[neighbourIndex] = INCONS;
+            else if (states[neighbourIndex] != INCONS)
+                Open(neighbourIndex);
+        }
+    }
+
+    Cell start;
+    Cell goal;
+    const ProfileCache* profile = nullptr;
+    bool manhattan = true;
+    int agentSize = 1;
+    float epsilon = 1.0f;       // Weight of the current pass
+    bool running = false;
+    double milliseconds = 0.0;  // Spent on this query so far
+
+    vector<float> g;
+    vector<float> keys;
+    vector<uint32_t> parents;
+    vector<State> states;
+    priority_queue<pair<float, uint32_t>, vector<pair<float, uint32_t>>, greater<pair<float, uint32_t>>> openList;
+    SearchStats pass;           // Counters for the pass in progress
+};
@@ -0,0 +1,209 @@
+#include "BoundedSearch.h"
+#include <chrono>
+#include <algorithm>
+
+vector<Cell> FindBoundedPath(Cell start, Cell end, const ProfileCache& profile, bool manhattan, BoundedSearchMemory& memory,
+    SearchStats* stats, int agentSize)
+{
+    using Slot = BoundedSearchMemory::Slot;
+    using Item = BoundedSearchMemory::Item;
+    const auto startTime = chrono::steady_clock::now();
+    const size_t startBytes = gBytesAllocated;
+    SearchStats counters;
+    if (!profile.Connected(start, end) || (agentSize > 1 && !profile.clearance.Fits(start, agentSize)))
+    {
+        if (stats != nullptr)
+            *stats = {};
+        return {};
+    }
+
+    vector<Slot>& slots = memory.slots;
+    vector<Item>& items = memory.items;
+    auto heuristic = [&](Cell cell)
+    {
+        return (manhattan ? Manhattan(cell, end) : Euclidean(cell, end)) + Chebyshev(cell, end) * profile.minCost;
+    };
+    auto cellOf = [](uint32_t index) { return Cell{ int(index % TILE_COUNT), int(index / TILE_COUNT) }; };
+    auto heapOrder = [](const Item& a, const Item& b) { return a.f > b.f; };
+
+    for (Slot& slot : slots)
+        slot.index = BoundedSearchMemory::EMPTY;
+    const size_t slotLimit = slots.size() * 3 / 4;  // Probes get long past three quarters full
+    const uint32_t startIndex = uint32_t(Index(start));
+    const uint32_t endIndex = uint32_t(Index(end));
+    slots[memory.Find(startIndex)] = { startIndex, startIndex, 0.0f, 0, false };
+    items[0] = { heuristic(start), startIndex };
+    size_t used = 1;
+    size_t open = 1;
+    counters.pushed++;
+    counters.peakOpen = 1;
+
+    // Forgotten & regenerated nodes can leave items behind from when they were cheaper
+    auto stale = [&](const Item& item, const Slot& slot)
+    {
+        return slot.index == BoundedSearchMemory::EMPTY || slot.closed || item.f < slot.g + heuristic(cellOf(slot.index));
+    };
+
+    // Drops stale items, keeping the best of each open node's others
+    auto compact = [&]()
+    {
+        size_t live = 0;
+        for (size_t i = 0; i < open; i++)
+        {
+            if (!stale(items[i], slots[memory.Find(items[i].index)]))
+                items[live++] = items[i];
+        }
+        sort(items.begin(), items.begin() + live, [](const Item& a, const Item& b) { return a.index < b.index || (a.index == b.index && a.f < b.f); });
+        open = unique(items.begin(), items.begin() + live, [](const Item& a, const Item& b) { return a.index == b.index; }) - items.begin();
+    };
+
+    // Makes room, returning whether there now is some. Anything childless can go, open or closed, so the cutoff is taken
+    // a quarter of the way down from the worst of them.
+    auto forgettable = [&](const Slot& slot)
+    {
+        return slot.index != BoundedSearchMemory::EMPTY && slot.children == 0 && slot.index != startIndex;
+    };
+    auto forget = [&]()
+    {
+        compact();
+        float lowest = FLT_MAX;
+        float highest = -FLT_MAX;
+        for (const Slot& slot : slots)
+        {
+            if (!forgettable(slot)) continue;
+            lowest = min(lowest, slot.g + heuristic(cellOf(slot.index)));
+            highest = max(highest, slot.g + heuristic(cellOf(slot.index)));
+        }
+        if (lowest == FLT_MAX) return false;
+        const float cutoff = highest - (highest - lowest) * 0.25f;
+
+        // Erasing shifts later entries back into the slot, so look at it again before moving on
+        for (size_t i = 0; i < slots.size() && open < items.size(); )
+        {
+            const Slot node = slots[i];
+            if (!forgettable(node) || node.g + heuristic(cellOf(node.index)) < cutoff)
+            {
+                i++;
+                continue;
+            }
+
+            Slot& parent = slots[memory.Find(node.parent)];
+            parent.children--;
+            parent.closed = false;
+            items[open++] = { node.g + heuristic(cellOf(node.index)), parent.index };
+            memory.Erase(i);
+            used--;
+            counters.evicted++;
+        }
+
+        compact();
+        make_heap(items.begin(), items.begin() + open, heapOrder);
+        return used < slotLimit && open < items.size();
+    };
+
+    bool found = false;
+    bool stuck = false;
+    while (open > 0 && !stuck)
+    {
+        pop_heap(items.begin(), items.begin() + open, heapOrder);
+        const uint32_t currentIndex = items[--open].index;
+        size_t currentSlot = memory.Find(currentIndex);
+        if (stale(items[open], slots[currentSlot]))
+        {
+            counters.stalePops++;
+            continue;
+        }
+        if (currentIndex == endIndex)
+        {
+            found = true;
+            break;
+        }
+        counters.expanded++;
+        if (counters.evicted > BOUNDED_SEARCH_CHURN * size_t(TILE_COUNT * TILE_COUNT))
+            stuck = true;
+
+        // Counting itself as a child keeps the node from being forgotten while it's being expanded
+        const float gCurrent = slots[currentSlot].g;
+        slots[currentSlot].closed = true;
+        slots[currentSlot].children++;
+        const Cell cell = cellOf(currentIndex);
+        for (const Cell& move : MOVES)
+        {
+            const Cell neighbour{ cell.col + move.col, cell.row + move.row };
+            if (!InBounds(neighbour)) continue;
+            if (agentSize > 1 && !profile.clearance.Fits(cell, neighbour, agentSize)) continue;
+
+            const uint32_t neighbourIndex = uint32_t(Index(neighbour));
+            const float terrain = profile.tileCosts[neighbourIndex];
+            if (terrain == IMPASSABLE) continue;
+
+            const float distance = manhattan ? Manhattan(cell, neighbour) : Euclidean(cell, neighbour);
+            const float gNew = gCurrent + distance + terrain;
+            size_t slot = memory.Find(neighbourIndex);
+            if (slots[slot].index != BoundedSearchMemory::EMPTY && gNew >= slots[slot].g) continue;
+
+            // Needs a free item, & a free slot if it's new, which forgetting may not be able to give us
+            if ((slots[slot].index == BoundedSearchMemory::EMPTY && used >= slotLimit) || open == items.size())
+            {
+                if (!forget())
+                {
+                    stuck = true;
+                    break;
+                }
+                slot = memory.Find(neighbourIndex);
+                if (slots[slot].index != BoundedSearchMemory::EMPTY && gNew >= slots[slot].g) continue;
+            }
+
+            // A cheaper way to a node already in the table moves it under this parent & reopens it
+            if (slots[slot].index == BoundedSearchMemory::EMPTY)
+            {
+                slots[slot] = { neighbourIndex, currentIndex, gNew, 0, false };
+                used++;
+            }
+            else
+            {
+                slots[memory.Find(slots[slot].parent)].children--;
+                slots[slot].parent = currentIndex;
+                slots[slot].g = gNew;
+                slots[slot].closed = false;
+            }
+            slots[memory.Find(currentIndex)].children++;
+            items[open++] = { gNew + heuristic(neighbour), neighbourIndex };
+            push_heap(items.begin(), items.begin() + open, heapOrder);
+            counters.pushed++;
+            counters.peakOpen = max(counters.peakOpen, open);
+        }
+        slots[memory.Find(currentIndex)].children--;
+    }
+
+    // Everything still in the table has its ancestors there too, so whichever tile ends up closest has a path back
+    vector<Cell> path;
+    if (found || stuck)
+    {
+        counters.partial = !found;
+        uint32_t last = endIndex;
+        if (stuck)
+        {
+            last = startIndex;
+            for (const Slot& slot : slots)
+            {
+                if (slot.index != BoundedSearchMemory::EMPTY && heuristic(cellOf(slot.index)) < heuristic(cellOf(last)))
+                    last = slot.index;
+            }
+        }
+        for (uint32_t index = last; ; index = slots[memory.Find(index)].parent)
+        {
+            path.push_back(cellOf(index));
+            if (index == startIndex) break;
+        }
+        reverse(path.begin(), path.end());
+    }
+
+    if (stats != nullptr)
+    {
+        counters.bytesAllocated = gBytesAllocated - startBytes;
+        counters.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        *stats = counters;
+    }
+    return path;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include "ProfileCache.h"
+#define BOUNDED_SEARCH_BYTES (64 * 1024)
+#define BOUNDED_SEARCH_CHURN 4
+
+// Scratch memory for FindBoundedPath, allocated once up front & reused by every query run in it, so a thread answering
+// queries never holds more than the bytes it was given however big the map is. Nodes live in a linear-probing hash
+// table of just the tiles a search has touched, & the open list is a heap of the same capacity.
+struct BoundedSearchMemory
+{
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    struct Slot
+    {
+        uint32_t index;     // Tile, EMPTY if the slot is free
+        uint32_t parent;    // Tile
+        float g;
+        uint16_t children;  // Nodes in the table with this one as their parent; only childless nodes can be forgotten
+        bool closed;
+    };
+
+    struct Item
+    {
+        float f;
+        uint32_t index;     // Tile
+    };
+
+    explicit BoundedSearchMemory(size_t bytes)
+        : slots(max<size_t>(bytes / (sizeof(Slot) + sizeof(Item)), 16)),
+          items(slots.size())
+    {
+    }
+
+    size_t Bytes() const
+    {
+        return slots.size() * sizeof(Slot) + items.size() * sizeof(Item);
+    }
+
+    size_t Home(uint32_t index) const
+    {
+        return (index * 2654435761u) % slots.size();
+    }
+
+    // Slot holding tile, or the free slot it would go in
+    size_t Find(uint32_t index) const
+    {
+        size_t slot = Home(index);
+        while (slots[slot].index != EMPTY && slots[slot].index != index)
+            slot = (slot + 1) % slots.size();
+        return slot;
+    }
+
+    // Backward-shift deletion: entries further along the probe sequence move up into the hole if their home allows,
+    // so lookups never need tombstones
+    void Erase(size_t slot)
+    {
+        size_t hole = slot;
+        for (size_t next = (hole + 1) % slots.size(); slots[next].index != EMPTY; next = (next + 1) % slots.size())
+        {
+            const size_t home = Home(slots[next].index);
+            const bool reachable = hole <= next ? (hole < home && home <= next) : (hole < home || home <= next);
+            if (!reachable)
+            {
+                slots[hole] = slots[next];
+                hole = next;
+            }
+        }
+        slots[hole].index = EMPTY;
+    }
+
+    vector<Slot> slots;
+    vector<Item> items;
+};
+
+// A* in a fixed budget of memory, for running many queries side by side without a Node per tile each. When the budget
+// fills it works like SMA*: childless nodes from the worst quarter of f upwards are forgotten, their f backed up into
+// their parents so they can be regenerated. Paths stay optimal as long as the best one fits. If nothing can be forgotten,
+// or it has forgotten BOUNDED_SEARCH_CHURN times as many nodes as the map has tiles, it returns the path to the tile it
+// got closest to the goal, flagged as partial in stats. Costs, clearance & the early outs are FindPath's for the profile.
+vector<Cell> FindBoundedPath(Cell start, Cell end, const ProfileCache& profile, bool manhattan, BoundedSearchMemory& memory,
+    SearchStats* stats = nullptr, int agentSize = 1);
@@ -0,0 +1,178 @@
+#include "Cpd.h"
+#include <queue>
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <cstdio>
+
+// Single-source Dijkstra using the same step costs as FindPath, returning the RLE first-move row of the source
+vector<uint32_t> BuildFirstMoveRow(Cell source, const Map& map, bool manhattan)
+{
+    const int nodeCount = TILE_COUNT * TILE_COUNT;
+    vector<float> distances(nodeCount, FLT_MAX);
+    vector<uint8_t> firstMoves(nodeCount, NO_MOVE);
+    vector<bool> closedList(nodeCount, false);
+
+    using Entry = pair<float, uint32_t>;
+    priority_queue<Entry, vector<Entry>, greater<Entry>> openList;
+    distances[Index(source)] = 0.0f;
+    openList.push({ 0.0f, (uint32_t)Index(source) });
+
+    while (!openList.empty())
+    {
+        const uint32_t currentIndex = openList.top().second;
+        openList.pop();
+        if (closedList[currentIndex]) continue;
+        closedList[currentIndex] = true;
+
+        const Cell current{ int(currentIndex % TILE_COUNT), int(currentIndex / TILE_COUNT) };
+        for (uint8_t move = 0; move < MOVES.size(); move++)
+        {
+            const Cell neighbour{ current.col + MOVES[move].col, current.row + MOVES[move].row };
+            if (neighbour.col < 0 || neighbour.col >= TILE_COUNT || neighbour.row < 0 || neighbour.row >= TILE_COUNT)
+                continue;
+
+            const size_t neighbourIndex = Index(neighbour);
+            const float distance = distances[currentIndex] + StepCost(current, neighbour, map, manhattan);
+            if (closedList[neighbourIndex] || distance >= distances[neighbourIndex]) continue;
+
+            // Targets inherit the first move of the tile they're reached through
+            distances[neighbourIndex] = distance;
+            firstMoves[neighbourIndex] = current == source ? move : firstMoves[currentIndex];
+            openList.push({ distance, (uint32_t)neighbourIndex });
+        }
+    }
+
+    vector<uint32_t> row;
+    for (uint32_t index = 0; index < (uint32_t)nodeCount; index++)
+    {
+        if (row.empty() || (row.back() & 0xF) != firstMoves[index])
+            row.push_back((index << 4) | firstMoves[index]);
+    }
+    return row;
+}
+
+
+CompressedPathDatabase BuildCompressedPathDatabase(const Map& map, uint64_t mapVersion, bool manhattan)
+{
+    const int nodeCount = TILE_COUNT * TILE_COUNT;
+    vector<vector<uint32_t>> rows(nodeCount);
+    atomic<int> nextSource{ 0 };
+
+    auto work = [&]()
+    {
+        for (int source = nextSource++; source < nodeCount; source = nextSource++)
+            rows[source] = BuildFirstMoveRow({ source % TILE_COUNT, source / TILE_COUNT }, map, manhattan);
+    };
+
+    vector<thread> workers;
+    const unsigned int threadCount = max(1u, thread::hardware_concurrency());
+    for (unsigned int i = 1; i < threadCount; i++)
+        workers.emplace_back(work);
+    work();
+    for (thread& worker : workers)
+        worker.join();
+
+    CompressedPathDatabase cpd;
+    cpd.mapVersion = mapVersion;
+    cpd.manhattan = manhattan;
+    cpd.rows.reserve(nodeCount + 1);
+    for (const vector<uint32_t>& row : rows)
+    {
+        cpd.rows.push_back((uint32_t)cpd.runs.size());
+        cpd.runs.insert(cpd.runs.end(), row.begin(), row.end());
+    }
+    cpd.rows.push_back((uint32_t)cpd.runs.size());
+    return cpd;
+}
+
+vector<Cell> FindPath(Cell start, Cell end, const CompressedPathDatabase& cpd)
+{
+    vector<Cell> path{ start };
+    Cell current = start;
+    while (!(current == end) && path.size() <= TILE_COUNT * TILE_COUNT)
+    {
+        const uint8_t move = cpd.FirstMove(current, end);
+        if (move == NO_MOVE) break;
+        current = { current.col + MOVES[move].col, current.row + MOVES[move].row };
+        path.push_back(current);
+    }
+    if (!(current == end))
+        path.clear();
+    return path;
+}
+
+bool SaveCompressedPathDatabase(const CompressedPathDatabase& cpd, const char* path)
+{
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file.is_open()) return false;
+
+    file.write("SCPD", 4);
+    Write<uint32_t>(file, TILE_COUNT);
+    Write<uint64_t>(file, cpd.mapVersion);
+    Write<uint8_t>(file, cpd.manhattan);
+    Write<uint32_t>(file, (uint32_t)cpd.runs.size());
+    file.write((const char*)cpd.rows.data(), cpd.rows.size() * sizeof(uint32_t));
+    file.write((const char*)cpd.runs.data(), cpd.runs.size() * sizeof(uint32_t));
+    return (bool)file;
+}
+
+bool LoadCompressedPathDatabase(CompressedPathDatabase& cpd, const char* path)
+{
+    cpd = {};
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) return false;
+
+    // It's loaded at startup, so anything FirstMove couldn't safely look up rejects the whole file rather than reading
+    // off the ends of runs or MOVES
+    auto corrupt = [&](const char* what)
+    {
+        printf("Corrupt path database in %s (%s), ignoring it\n", path, what);
+        cpd = {};
+        return false;
+    };
+
+    char magic[4];
+    uint32_t tileCount, runCount;
+    uint64_t mapVersion;
+    uint8_t manhattan;
+    if (!file.read(magic, 4) || memcmp(magic, "SCPD", 4) != 0 || !Read(file, tileCount) || tileCount != TILE_COUNT ||
+        !Read(file, mapVersion) || !Read(file, manhattan) || !Read(file, runCount))
+        return false;
+
+    // Each source has at least one run & at most one per target
+    const uint64_t tiles = TILE_COUNT * TILE_COUNT;
+    const uint64_t headerBytes = uint64_t(file.tellg());
+    file.seekg(0, ios::end);
+    const uint64_t fileBytes = uint64_t(file.tellg());
+    file.seekg(headerBytes);
+    if (runCount < tiles || runCount > tiles * tiles) return corrupt("bad run count");
+    if (fileBytes - headerBytes != (tiles + 1 + runCount) * sizeof(uint32_t)) return corrupt("wrong size");
+
+    cpd.rows.resize(tiles + 1);
+    cpd.runs.resize(runCount);
+    if (!file.read((char*)cpd.rows.data(), cpd.rows.size() * sizeof(uint32_t)) ||
+        !file.read((char*)cpd.runs.data(), cpd.runs.size() * sizeof(uint32_t)))
+        return corrupt("truncated");
+
+    // Every row holds runs whose targets start at 0 & climb within the map, & whose moves are real ones or NO_MOVE
+    if (cpd.rows.front() != 0 || cpd.rows.back() != runCount) return corrupt("rows don't cover the runs");
+    for (size_t source = 0; source < tiles; source++)
+    {
+        const uint32_t begin = cpd.rows[source];
+        const uint32_t end = cpd.rows[source + 1];
+        if (begin >= end || end > runCount) return corrupt("empty or out of order row");
+        if ((cpd.runs[begin] >> 4) != 0) return corrupt("row doesn't start at the first target");
+        for (uint32_t run = begin; run < end; run++)
+        {
+            const uint32_t target = cpd.runs[run] >> 4;
+            const uint32_t move = cpd.runs[run] & 0xF;
+            if (target >= tiles || (run > begin && target <= (cpd.runs[run - 1] >> 4))) return corrupt("bad run target");
+            if (move >= MOVES.size() && move != NO_MOVE) return corrupt("bad move");
+        }
+    }
+
+    cpd.mapVersion = mapVersion;
+    cpd.manhattan = manhattan != 0;
+    return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "Grid.h"
+
+// Compressed Path Database: for every source tile, the first move of a shortest path to every target tile.
+// Each source row is run-length encoded over target indices, runs packed as (first target << 4) | move.
+struct CompressedPathDatabase
+{
+    // First move from source towards target, NO_MOVE if they're the same tile (or target is unreachable)
+    uint8_t FirstMove(Cell source, Cell target) const
+    {
+        const uint32_t index = (uint32_t)Index(target);
+        const auto begin = runs.begin() + rows[Index(source)];
+        const auto end = runs.begin() + rows[Index(source) + 1];
+
+        // Last run starting at or before the target
+        auto run = upper_bound(begin, end, index, [](uint32_t i, uint32_t packed) { return i < (packed >> 4); });
+        return uint8_t(*(run - 1) & 0xF);
+    }
+
+    bool Empty() const
+    {
+        return rows.empty();
+    }
+
+    size_t Bytes() const
+    {
+        return rows.size() * sizeof(uint32_t) + runs.size() * sizeof(uint32_t);
+    }
+
+    uint64_t mapVersion = 0;
+    bool manhattan = true;
+    vector<uint32_t> rows;  // rows[source] .. rows[source + 1] is that source's slice of runs
+    vector<uint32_t> runs;
+};
+
+// Runs a Dijkstra per source tile, spread over every core
+CompressedPathDatabase BuildCompressedPathDatabase(const Map& map, uint64_t mapVersion, bool manhattan);
+
+// Follows first moves from start to goal, giving a path costing what FindPath's does (empty if there's no way)
+vector<Cell> FindPath(Cell start, Cell end, const CompressedPathDatabase& cpd);
+
+// Layout: "SCPD", u32 TILE_COUNT, u64 map version, u8 manhattan, u32 run count, rows, runs
+bool SaveCompressedPathDatabase(const CompressedPathDatabase& cpd, const char* path);
+bool LoadCompressedPathDatabase(CompressedPathDatabase& cpd, const char* path);
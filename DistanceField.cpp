@@ -0,0 +1,138 @@
+#include "DistanceField.h"
+#include <queue>
+#include <algorithm>
+
+vector<float> DistancesToGoal(const TileGrid& grid, Cell goal, bool manhattan)
+{
+    vector<float> distances(grid.tiles.size(), FLT_MAX);
+    using Entry = pair<float, uint32_t>;
+    priority_queue<Entry, vector<Entry>, greater<Entry>> openList;
+    distances[grid.Index(goal)] = 0.0f;
+    openList.push({ 0.0f, (uint32_t)grid.Index(goal) });
+    while (!openList.empty())
+    {
+        const auto [distance, index] = openList.top();
+        openList.pop();
+        if (distance > distances[index]) continue;
+
+        // Moving neighbour -> cell costs the terrain of cell
+        const Cell cell = grid.CellOf(index);
+        for (const Cell& move : MOVES)
+        {
+            const Cell neighbour{ cell.col + move.col, cell.row + move.row };
+            if (!grid.InBounds(neighbour)) continue;
+            const float candidate = distance + grid.StepCost(neighbour, cell, manhattan);
+            if (candidate < distances[grid.Index(neighbour)])
+            {
+                distances[grid.Index(neighbour)] = candidate;
+                openList.push({ candidate, (uint32_t)grid.Index(neighbour) });
+            }
+        }
+    }
+    return distances;
+}
+
+vector<float> DistancesToGoal(const Map& map, Cell goal, bool manhattan)
+{
+    return DistancesToGoal(TileGrid(map), goal, manhattan);
+}
+
+vector<float> DistancesToGoal(const TileGrid& grid, Cell goal, bool manhattan, WorkerPool& pool)
+{
+    const size_t tileCount = grid.tiles.size();
+    const size_t grain = 256;
+    vector<atomic<float>> distances(tileCount);
+    for (atomic<float>& distance : distances)
+        distance.store(FLT_MAX, memory_order_relaxed);
+    distances[grid.Index(goal)].store(0.0f, memory_order_relaxed);
+
+    // Tiles are only queued once per bucket, & taken off it when relaxed; entries left behind in later buckets by a
+    // tile whose distance has since dropped are skipped when those buckets come up
+    vector<vector<uint32_t>> buckets(1, vector<uint32_t>{ uint32_t(grid.Index(goal)) });
+    vector<uint32_t> queuedIn(tileCount, UINT32_MAX);
+    queuedIn[grid.Index(goal)] = 0;
+    auto bucketOf = [&](uint32_t index) { return size_t(distances[index].load(memory_order_relaxed) / DELTA_STEP); };
+
+    // Moving neighbour -> cell costs the terrain of cell
+    auto relax = [&](uint32_t index, bool light, vector<uint32_t>& improved)
+    {
+        const float distance = distances[index].load(memory_order_relaxed);
+        const Cell cell = grid.CellOf(index);
+        for (const Cell& move : MOVES)
+        {
+            const Cell neighbour{ cell.col + move.col, cell.row + move.row };
+            if (!grid.InBounds(neighbour)) continue;
+            const float weight = grid.StepCost(neighbour, cell, manhattan);
+            if ((weight <= DELTA_STEP) != light) continue;
+
+            const float candidate = distance + weight;
+            atomic<float>& target = distances[grid.Index(neighbour)];
+            float current = target.load(memory_order_relaxed);
+            while (candidate < current)
+            {
+                if (target.compare_exchange_weak(current, candidate, memory_order_relaxed))
+                {
+                    improved.push_back(uint32_t(grid.Index(neighbour)));
+                    break;
+                }
+            }
+        }
+    };
+
+    // Each chunk lists the tiles it improved on its own, so threads only contend on the atomic min of a single distance
+    vector<vector<uint32_t>> improved;
+    auto relaxAll = [&](const vector<uint32_t>& tiles, bool light)
+    {
+        const size_t chunks = (tiles.size() + grain - 1) / grain;
+        if (improved.size() < chunks)
+            improved.resize(chunks);
+        pool.ParallelFor(tiles.size(), grain, [&](size_t begin, size_t end)
+        {
+            vector<uint32_t>& chunkImproved = improved[begin / grain];
+            for (size_t i = begin; i < end; i++)
+                relax(tiles[i], light, chunkImproved);
+        });
+
+        for (size_t chunk = 0; chunk < chunks; chunk++)
+        {
+            for (uint32_t index : improved[chunk])
+            {
+                const size_t bucket = bucketOf(index);
+                if (queuedIn[index] == bucket) continue;
+                queuedIn[index] = uint32_t(bucket);
+                if (buckets.size() <= bucket)
+                    buckets.resize(bucket + 1);
+                buckets[bucket].push_back(index);
+            }
+            improved[chunk].clear();
+        }
+    };
+
+    vector<uint32_t> frontier;
+    vector<uint32_t> settled;
+    for (size_t current = 0; current < buckets.size(); current++)
+    {
+        settled.clear();
+        while (!buckets[current].empty())
+        {
+            frontier.swap(buckets[current]);
+            buckets[current].clear();
+            frontier.erase(remove_if(frontier.begin(), frontier.end(),
+                [&](uint32_t index) { return bucketOf(index) != current; }), frontier.end());
+            for (uint32_t index : frontier)
+                queuedIn[index] = UINT32_MAX;
+
+            settled.insert(settled.end(), frontier.begin(), frontier.end());
+            relaxAll(frontier, true);
+        }
+
+        sort(settled.begin(), settled.end());
+        settled.erase(unique(settled.begin(), settled.end()), settled.end());
+        relaxAll(settled, false);
+    }
+
+    vector<float> result(tileCount);
+    for (size_t i = 0; i < tileCount; i++)
+        result[i] = distances[i].load(memory_order_relaxed);
+    return result;
+}
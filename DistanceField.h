@@ -0,0 +1,13 @@
+#pragma once
+#include "Grid.h"
+#include "WorkerPool.h"
+#define DELTA_STEP 16.0f
+
+// Exact cost-to-goal of every tile (a backwards Dijkstra), the "hierarchical" heuristic of WHCA*
+vector<float> DistancesToGoal(const TileGrid& grid, Cell goal, bool manhattan);
+
+vector<float> DistancesToGoal(const Map& map, Cell goal, bool manhattan);
+
+// Delta-stepping: the same field as DistancesToGoal, settled a bucket of DELTA_STEP cost at a time. Each bucket's light
+// edges (costing at most DELTA_STEP) are relaxed in parallel until it stops refilling, then its heavy edges in one pass.
+vector<float> DistancesToGoal(const TileGrid& grid, Cell goal, bool manhattan, WorkerPool& pool);
@@ -0,0 +1,54 @@
+#include "Grid.h"
+
+thread_local size_t gBytesAllocated = 0;
+
+const array<MovementProfile, PROFILE_COUNT>& MovementProfiles()
+{
+    static const array<MovementProfile, PROFILE_COUNT> profiles
+    {
+        //                              AIR         GRASS        WATER        MUD        MOUNTAIN
+        MovementProfile{ "Standard", { Cost(AIR),  Cost(GRASS), Cost(WATER), Cost(MUD), Cost(MOUNTAIN) } },
+        MovementProfile{ "Infantry", { 0.0f,       5.0f,        60.0f,       20.0f,     80.0f } },
+        MovementProfile{ "Boat",     { IMPASSABLE, IMPASSABLE,  5.0f,        40.0f,     IMPASSABLE } },
+        MovementProfile{ "Vehicle",  { 0.0f,       5.0f,        IMPASSABLE,  80.0f,     IMPASSABLE } },
+    };
+    return profiles;
+}
+
+float LineCost(Cell from, Cell to, const Map& map)
+{
+    return LineCost(from, to, StandardEnterCost(map));
+}
+
+float PathCost(const vector<Cell>& path, const Map& map, bool manhattan)
+{
+    return PathCost(path, StandardEnterCost(map), manhattan);
+}
+
+Map SizeClassMap(const Map& map, const ClearanceMap& clearance, int size)
+{
+    Map sized = map;
+    for (int row = 0; row < TILE_COUNT; row++)
+    {
+        for (int col = 0; col < TILE_COUNT; col++)
+        {
+            if (clearance.values[Index({ col, row })] < size)
+                sized[row][col] = MOUNTAIN;
+        }
+    }
+    return sized;
+}
+
+uint64_t MapVersion(const Map& map)
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const auto& row : map)
+    {
+        for (size_t tile : row)
+        {
+            hash ^= tile;
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
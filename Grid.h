@@ -0,0 +1,449 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#ifndef TILE_COUNT
+#define TILE_COUNT 10
+#endif
+#define TRACE_CAPACITY 4096
+#define MAX_AGENT_SIZE 4
+
+using namespace std;
+
+// Heap bytes requested on this thread, counted by main.cpp's allocator in -DPROFILE_ALLOCATIONS builds
+extern thread_local size_t gBytesAllocated;
+
+using Map = array<array<size_t, TILE_COUNT>, TILE_COUNT>;
+
+enum TileType : size_t
+{
+    AIR,
+    GRASS,
+    WATER,
+    MUD,
+    MOUNTAIN,
+    COUNT
+};
+
+struct Cell
+{
+    int col = -1;
+    int row = -1;
+};
+
+inline bool operator==(Cell a, Cell b)
+{
+    return a.row == b.row && a.col == b.col;
+}
+
+inline float Manhattan(Cell a, Cell b)
+{
+    return abs(b.col - a.col) + abs(b.row - a.row);
+}
+
+// Fewest 8-way steps between two tiles
+inline float Chebyshev(Cell a, Cell b)
+{
+    return max(abs(b.col - a.col), abs(b.row - a.row));
+}
+
+inline float Euclidean(Cell a, Cell b)
+{
+    return sqrtf(powf(b.col - a.col, 2.0f) + powf(b.row - a.row, 2.0f));
+    //return sqrtf((b.col - a.col) * (b.col - a.col) + (b.row - a.row) * (b.row - a.row));
+    // Identical to the above implementation
+}
+
+inline bool InBounds(Cell cell)
+{
+    return cell.col >= 0 && cell.col < TILE_COUNT && cell.row >= 0 && cell.row < TILE_COUNT;
+}
+
+// Go from 2d to 1d (necessary for path finding data structures)
+inline size_t Index(Cell cell)
+{
+    return cell.row * TILE_COUNT + cell.col;
+}
+
+// Go from 1d to 2d
+//Cell From(size_t index)
+//{
+//    return { index % TILE_COUNT, index / TILE_COUNT };
+//}
+
+inline float Cost(TileType type)
+{
+    static array<float, COUNT> costs
+    {
+        0.0f,   // AIR
+        10.0f,  // GRASS
+        25.0f,  // WATER
+        50.0f,  // MUD
+        100.0f, // MOUNTAIN
+    };
+
+    return costs[type];
+}
+
+// Terrain cost of tiles a movement profile can't enter at all
+constexpr float IMPASSABLE = FLT_MAX;
+
+enum MovementProfileId : int
+{
+    STANDARD_PROFILE,
+    INFANTRY_PROFILE,
+    BOAT_PROFILE,
+    VEHICLE_PROFILE,
+    PROFILE_COUNT
+};
+
+// How one kind of unit values terrain, in place of the standard Cost table
+struct MovementProfile
+{
+    const char* name;
+    array<float, COUNT> costs;
+};
+
+const array<MovementProfile, PROFILE_COUNT>& MovementProfiles();
+
+// Cost of stepping between adjacent tiles: distance travelled plus the terrain cost of the tile entered
+inline float StepCost(Cell from, Cell to, const Map& map, bool manhattan)
+{
+    const float distance = manhattan ? Manhattan(from, to) : Euclidean(from, to);
+    return distance + Cost((TileType)map[to.row][to.col]);
+}
+
+// Cost of the straight line between two tile centres: its length plus enterCost(previous, cell) for every tile it
+// enters, IMPASSABLE if any of those is. Lines through a corner go straight to the diagonal tile, charging neither side.
+template<typename EnterCost>
+float LineCost(Cell from, Cell to, EnterCost enterCost)
+{
+    int dx = abs(to.col - from.col);
+    int dy = abs(to.row - from.row);
+    const int stepX = to.col > from.col ? 1 : -1;
+    const int stepY = to.row > from.row ? 1 : -1;
+
+    // Grid traversal with an integer error term, doubled so centre-to-centre lines stay exact
+    float terrain = 0.0f;
+    Cell cell = from;
+    Cell previous = from;
+    int error = dx - dy;
+    dx *= 2;
+    dy *= 2;
+    while (cell.col != to.col || cell.row != to.row)
+    {
+        if (error > 0)
+        {
+            cell.col += stepX;
+            error -= dy;
+        }
+        else if (error < 0)
+        {
+            cell.row += stepY;
+            error += dx;
+        }
+        else
+        {
+            cell.col += stepX;
+            cell.row += stepY;
+            error += dx - dy;
+        }
+        const float cost = enterCost(previous, cell);
+        if (cost == IMPASSABLE)
+            return IMPASSABLE;
+        terrain += cost;
+        previous = cell;
+    }
+    return Euclidean(from, to) + terrain;
+}
+
+// enterCost for LineCost & SmoothPath under the standard Cost table
+inline auto StandardEnterCost(const Map& map)
+{
+    return [&map](Cell, Cell cell) { return Cost((TileType)map[cell.row][cell.col]); };
+}
+
+float LineCost(Cell from, Cell to, const Map& map);
+
+// Waypoints further apart than a single step (from any-angle searches or smoothing) are costed along the line between
+// them. IMPASSABLE if enterCost says any of it can't be walked.
+template<typename EnterCost>
+float PathCost(const vector<Cell>& path, EnterCost enterCost, bool manhattan)
+{
+    float cost = 0.0f;
+    for (size_t i = 1; i < path.size(); i++)
+    {
+        const bool adjacent = abs(path[i].col - path[i - 1].col) <= 1 && abs(path[i].row - path[i - 1].row) <= 1;
+        const float distance = manhattan ? Manhattan(path[i - 1], path[i]) : Euclidean(path[i - 1], path[i]);
+        const float terrain = adjacent ? enterCost(path[i - 1], path[i]) : LineCost(path[i - 1], path[i], enterCost);
+        if (terrain == IMPASSABLE) return IMPASSABLE;
+        cost += adjacent ? distance + terrain : terrain;
+    }
+    return cost;
+}
+
+float PathCost(const vector<Cell>& path, const Map& map, bool manhattan);
+
+// Returns all adjacent cells to the passed-in cell (up, down, left, right & diagonals)
+inline vector<Cell> Neighbours(Cell cell)
+{
+    vector<Cell> neighbours;
+    for (int row = -1; row <= 1; row++)
+    {
+        for (int col = -1; col <= 1; col++)
+        {
+            // Don't add the passed-in cell to the list
+            if (row == 0 && col == 0) continue;
+
+            Cell neighbour{ cell.col + col, cell.row + row };
+            if (neighbour.col >= 0 && neighbour.col < TILE_COUNT &&
+                neighbour.row >= 0 && neighbour.row < TILE_COUNT)
+                neighbours.push_back(neighbour);
+        }
+    }
+    return neighbours;
+}
+
+// The 8 moves in the same order Neighbours() generates them
+constexpr array<Cell, 8> MOVES
+{
+    Cell{ -1, -1 }, Cell{ 0, -1 }, Cell{ 1, -1 },
+    Cell{ -1,  0 },                Cell{ 1,  0 },
+    Cell{ -1,  1 }, Cell{ 0,  1 }, Cell{ 1,  1 },
+};
+constexpr uint8_t NO_MOVE = 8;
+
+struct Node
+{
+    Node()
+    {
+        Init();
+    }
+
+    Node(Cell cell)
+    {
+        Init(cell);
+    }
+
+    Node(Cell cell, float g, float h)
+    {
+        Init(cell, {}, g, h);
+    }
+
+    Node(Cell cell, Cell parent, float g, float h)
+    {
+        Init(cell, parent, g, h);
+    }
+
+    void Init(Cell cell = {}, Cell parent = {}, float g = 0.0f, float h = 0.0f)
+    {
+        this->cell = cell;
+        this->parent = parent;
+        this->g = g;
+        this->h = h;
+    }
+
+    float F() { return g + h; }
+
+    float g;
+    float h;
+
+    Cell cell;
+    Cell parent;
+};
+
+inline bool Compare(Node a, Node b)
+{
+    return a.F() > b.F();
+}
+
+// What a single FindPath call cost us
+struct SearchStats
+{
+    size_t expanded = 0;        // Nodes popped & expanded
+    size_t pushed = 0;          // Nodes pushed onto the open list
+    size_t stalePops = 0;       // Popped duplicates of nodes that were already closed
+    size_t peakOpen = 0;        // Largest the open list got
+    size_t bytesAllocated = 0;  // Heap bytes requested during the search, always 0 without PROFILE_ALLOCATIONS
+    double milliseconds = 0.0;  // Wall time
+    float bound = 1.0f;         // Proven worst case cost of the path found over the optimal one
+    size_t evicted = 0;         // Open nodes a memory-bounded search forgot to stay within its budget
+    bool partial = false;       // A memory-bounded search gave up & the path only gets as close to the goal as it could
+};
+
+// One pop off the open list, packed so long traces stay small
+struct TraceEvent
+{
+    uint32_t index; // Tile index, high bit set if the pop was a stale duplicate
+    float g;
+    float h;
+};
+
+constexpr uint32_t TRACE_STALE = 1u << 31;
+
+// Ring buffer of the most recent pops, plus the final node of every tile once the search is done
+struct SearchTrace
+{
+    void Clear()
+    {
+        events.resize(TRACE_CAPACITY);
+        total = 0;
+        nodes.clear();
+    }
+
+    void Record(Cell cell, float g, float h, bool stale)
+    {
+        events[total % TRACE_CAPACITY] = { uint32_t(Index(cell)) | (stale ? TRACE_STALE : 0u), g, h };
+        total++;
+    }
+
+    // Number of events still in the buffer, Event(0) being the oldest
+    size_t Count() const
+    {
+        return min(total, (size_t)TRACE_CAPACITY);
+    }
+
+    const TraceEvent& Event(size_t i) const
+    {
+        const size_t oldest = total > TRACE_CAPACITY ? total % TRACE_CAPACITY : 0;
+        return events[(oldest + i) % TRACE_CAPACITY];
+    }
+
+    vector<TraceEvent> events;
+    size_t total = 0;
+    vector<Node> nodes;
+};
+
+// True clearance: the largest square of non-mountain tiles with its top-left corner on each tile, capped at
+// MAX_AGENT_SIZE. An agent k tiles across, anchored at its top-left tile, fits wherever the clearance is at least k.
+struct ClearanceMap
+{
+    void Build(const Map& map)
+    {
+        values.assign(TILE_COUNT * TILE_COUNT, 0);
+        for (int index = TILE_COUNT * TILE_COUNT - 1; index >= 0; index--)
+            Recompute(map, { index % TILE_COUNT, index / TILE_COUNT });
+    }
+
+    // Only tiles less than MAX_AGENT_SIZE above & left of a changed tile can see it. Each tile depends on the ones right &
+    // below it, so recomputing in reverse raster order always reads values that are already up to date.
+    void Update(const Map& map, const vector<Cell>& changed)
+    {
+        vector<size_t> dirty;
+        for (const Cell& cell : changed)
+        {
+            for (int row = max(0, cell.row - MAX_AGENT_SIZE + 1); row <= cell.row; row++)
+            {
+                for (int col = max(0, cell.col - MAX_AGENT_SIZE + 1); col <= cell.col; col++)
+                    dirty.push_back(Index({ col, row }));
+            }
+        }
+        sort(dirty.begin(), dirty.end(), greater<size_t>());
+        dirty.erase(unique(dirty.begin(), dirty.end()), dirty.end());
+        for (size_t index : dirty)
+            Recompute(map, { int(index % TILE_COUNT), int(index / TILE_COUNT) });
+    }
+
+    void Recompute(const Map& map, Cell cell)
+    {
+        uint8_t& value = values[Index(cell)];
+        if (map[cell.row][cell.col] == MOUNTAIN)
+        {
+            value = 0;
+            return;
+        }
+
+        const bool right = cell.col + 1 < TILE_COUNT;
+        const bool below = cell.row + 1 < TILE_COUNT;
+        const uint8_t smallest = min({
+            right ? values[Index({ cell.col + 1, cell.row })] : uint8_t(0),
+            below ? values[Index({ cell.col, cell.row + 1 })] : uint8_t(0),
+            right && below ? values[Index({ cell.col + 1, cell.row + 1 })] : uint8_t(0) });
+        value = (uint8_t)min(MAX_AGENT_SIZE, smallest + 1);
+    }
+
+    // Whether an agent of the given size can stand with its top-left corner on cell
+    bool Fits(Cell cell, int size) const
+    {
+        return values[Index(cell)] >= size;
+    }
+
+    // Whether an agent of the given size can step from -> to. Diagonal steps also need room on both sides, so agents
+    // don't cut corners.
+    bool Fits(Cell from, Cell to, int size) const
+    {
+        if (!Fits(to, size)) return false;
+        if (from.col != to.col && from.row != to.row)
+            return Fits({ to.col, from.row }, size) && Fits({ from.col, to.row }, size);
+        return true;
+    }
+
+    vector<uint8_t> values;
+};
+
+// The map as an agent of the given size sees it: tiles it can't be anchored on become mountains. Structures built for
+// single tiles that treat mountains as walls (like subgoal graphs) then work per size class unchanged.
+Map SizeClassMap(const Map& map, const ClearanceMap& clearance, int size);
+
+// A map of any size, for the command-line benchmarks: MovingAI maps run to thousands of tiles across, far past
+// TILE_COUNT, & a Map that big wouldn't fit on the stack. Tiles are row-major on the heap.
+struct TileGrid
+{
+    TileGrid() = default;
+
+    explicit TileGrid(const Map& map)
+        : width(TILE_COUNT), height(TILE_COUNT), tiles(TILE_COUNT * TILE_COUNT)
+    {
+        for (int row = 0; row < TILE_COUNT; row++)
+        {
+            for (int col = 0; col < TILE_COUNT; col++)
+                tiles[Index({ col, row })] = uint8_t(map[row][col]);
+        }
+    }
+
+    bool InBounds(Cell cell) const
+    {
+        return cell.col >= 0 && cell.col < width && cell.row >= 0 && cell.row < height;
+    }
+
+    size_t Index(Cell cell) const
+    {
+        return size_t(cell.row) * width + cell.col;
+    }
+
+    Cell CellOf(size_t index) const
+    {
+        return { int(index % width), int(index / width) };
+    }
+
+    // StepCost on this grid
+    float StepCost(Cell from, Cell to, bool manhattan) const
+    {
+        const float distance = manhattan ? Manhattan(from, to) : Euclidean(from, to);
+        return distance + Cost((TileType)tiles[Index(to)]);
+    }
+
+    int width = 0;
+    int height = 0;
+    vector<uint8_t> tiles;
+};
+
+// FNV-1a over the tiles, used as the map version so logged queries know which map they ran against
+uint64_t MapVersion(const Map& map);
+
+template<typename T>
+void Write(ofstream& file, T value)
+{
+    file.write((const char*)&value, sizeof(T));
+}
+
+template<typename T>
+bool Read(ifstream& file, T& value)
+{
+    return (bool)file.read((char*)&value, sizeof(T));
+}
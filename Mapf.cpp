@@ -0,0 +1,601 @@
+#include "Mapf.h"
+#include "DistanceField.h"
+#include "SubgoalGraph.h"
+#include <queue>
+#include <chrono>
+#include <unordered_map>
+#include <unordered_set>
+
+// Space-time reservation table for cooperative pathfinding. A ring buffer of RESERVATION_WINDOW + 1 time layers, each
+// entry stamped with the absolute time & planning window it was reserved in, so lookups are a single index and starting
+// a new window never needs to clear anything.
+struct ReservationTable
+{
+    struct Entry
+    {
+        uint32_t time = UINT32_MAX;
+        uint32_t window = UINT32_MAX;
+        uint32_t agent = 0;
+    };
+
+    ReservationTable()
+    {
+        entries.resize((RESERVATION_WINDOW + 1) * TILE_COUNT * TILE_COUNT);
+    }
+
+    // Drops every reservation made so far
+    void NextWindow()
+    {
+        window++;
+    }
+
+    void Reserve(uint32_t time, Cell cell, uint32_t agent)
+    {
+        entries[Slot(time, cell)] = { time, window, agent };
+    }
+
+    // Reserved by someone other than agent
+    bool Taken(uint32_t time, Cell cell, uint32_t agent) const
+    {
+        const uint32_t owner = Owner(time, cell);
+        return owner != UINT32_MAX && owner != agent;
+    }
+
+    uint32_t Owner(uint32_t time, Cell cell) const
+    {
+        const Entry& entry = entries[Slot(time, cell)];
+        return entry.time == time && entry.window == window ? entry.agent : UINT32_MAX;
+    }
+
+    size_t Slot(uint32_t time, Cell cell) const
+    {
+        return (time % (RESERVATION_WINDOW + 1)) * TILE_COUNT * TILE_COUNT + Index(cell);
+    }
+
+    vector<Entry> entries;
+    uint32_t window = 0;
+};
+
+// Time-extended A* over (tile, time) from start at time "now" to the end of the window, avoiding other agents'
+// reservations (including head-on swaps & diagonal moves that cross). Waiting costs 1 except on the goal, where it's free.
+// Returns the tile at each time step now..now + RESERVATION_WINDOW, or an empty path if every option is reserved.
+vector<Cell> PlanWindow(const Map& map, const ReservationTable& reservations, uint32_t agent, Cell start, Cell goal,
+    uint32_t now, const vector<float>& distances, bool manhattan, CooperativeStats& stats)
+{
+    struct State
+    {
+        float f;
+        float g;
+        uint32_t step;
+        uint32_t index;
+        bool operator>(const State& other) const { return f > other.f; }
+    };
+
+    const size_t nodeCount = TILE_COUNT * TILE_COUNT;
+    auto key = [nodeCount](uint32_t step, size_t index) { return step * nodeCount + index; };
+
+    unordered_map<uint64_t, float> g;
+    unordered_map<uint64_t, uint64_t> parents;
+    unordered_set<uint64_t> closedList;
+    priority_queue<State, vector<State>, greater<State>> openList;
+
+    g[key(0, Index(start))] = 0.0f;
+    openList.push({ distances[Index(start)], 0.0f, 0, (uint32_t)Index(start) });
+
+    while (!openList.empty())
+    {
+        const State state = openList.top();
+        openList.pop();
+        const uint64_t stateKey = key(state.step, state.index);
+        if (!closedList.insert(stateKey).second) continue;
+        stats.expanded++;
+
+        if (state.step == RESERVATION_WINDOW)
+        {
+            vector<Cell> path(RESERVATION_WINDOW + 1);
+            uint64_t current = stateKey;
+            for (int step = RESERVATION_WINDOW; step >= 0; step--)
+            {
+                const size_t index = current % nodeCount;
+                path[step] = { int(index % TILE_COUNT), int(index / TILE_COUNT) };
+                if (step > 0) current = parents[current];
+            }
+            return path;
+        }
+
+        const Cell cell{ int(state.index % TILE_COUNT), int(state.index / TILE_COUNT) };
+        const uint32_t time = now + state.step;
+
+        // Someone else moves from -> to between time & time + 1
+        auto moving = [&](Cell from, Cell to)
+        {
+            const uint32_t owner = reservations.Owner(time, from);
+            return owner != UINT32_MAX && owner != agent && reservations.Owner(time + 1, to) == owner;
+        };
+        auto expand = [&](Cell next, float cost)
+        {
+            if (reservations.Taken(time + 1, next, agent)) return;
+
+            // Swapping tiles with another agent, or crossing its diagonal, means passing through each other
+            if (moving(next, cell)) return;
+            if (next.col != cell.col && next.row != cell.row &&
+                (moving({ next.col, cell.row }, { cell.col, next.row }) || moving({ cell.col, next.row }, { next.col, cell.row })))
+                return;
+
+            const uint64_t nextKey = key(state.step + 1, Index(next));
+            const float gNext = state.g + cost;
+            auto it = g.find(nextKey);
+            if (closedList.count(nextKey) || (it != g.end() && it->second <= gNext)) return;
+
+            g[nextKey] = gNext;
+            parents[nextKey] = stateKey;
+            openList.push({ gNext + distances[Index(next)], gNext, state.step + 1, (uint32_t)Index(next) });
+        };
+
+        expand(cell, cell == goal ? 0.0f : 1.0f);
+        for (const Cell& neighbour : Neighbours(cell))
+            expand(neighbour, StepCost(cell, neighbour, map, manhattan));
+    }
+    return {};
+}
+
+vector<vector<Cell>> PlanCooperative(const Map& map, const vector<Cell>& starts, const vector<Cell>& goals, bool manhattan,
+    size_t maxWindows, CooperativeStats* stats)
+{
+    const auto startTime = chrono::steady_clock::now();
+    CooperativeStats counters;
+    const size_t agentCount = starts.size();
+
+    vector<vector<float>> distances;
+    for (const Cell& goal : goals)
+        distances.push_back(DistancesToGoal(map, goal, manhattan));
+
+    vector<vector<Cell>> paths(agentCount);
+    for (size_t i = 0; i < agentCount; i++)
+        paths[i].push_back(starts[i]);
+
+    ReservationTable reservations;
+    uint32_t now = 0;
+    for (; counters.windows < maxWindows; counters.windows++)
+    {
+        bool arrived = true;
+        for (size_t i = 0; i < agentCount; i++)
+            arrived = arrived && paths[i].back() == goals[i];
+        if (arrived)
+        {
+            counters.allArrived = true;
+            break;
+        }
+
+        // Everyone holds their current tile until they've had a chance to plan
+        reservations.NextWindow();
+        for (size_t i = 0; i < agentCount; i++)
+        {
+            reservations.Reserve(now, paths[i].back(), (uint32_t)i);
+            reservations.Reserve(now + 1, paths[i].back(), (uint32_t)i);
+        }
+
+        vector<vector<Cell>> windows(agentCount);
+        for (size_t order = 0; order < agentCount; order++)
+        {
+            const size_t i = (order + counters.windows) % agentCount;
+            windows[i] = PlanWindow(map, reservations, (uint32_t)i, paths[i].back(), goals[i], now, distances[i], manhattan, counters);
+            if (windows[i].empty())
+            {
+                windows[i].assign(RESERVATION_WINDOW + 1, paths[i].back());
+                counters.failedSearches++;
+            }
+            for (uint32_t step = 0; step <= RESERVATION_WINDOW; step++)
+                reservations.Reserve(now + step, windows[i][step], (uint32_t)i);
+        }
+
+        for (size_t i = 0; i < agentCount; i++)
+            paths[i].insert(paths[i].end(), windows[i].begin() + 1, windows[i].begin() + 1 + RESERVATION_WINDOW / 2);
+        now += RESERVATION_WINDOW / 2;
+    }
+
+    if (stats != nullptr)
+    {
+        counters.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        *stats = counters;
+    }
+    return paths;
+}
+
+// Stops agent from being on cell at time, or, when from is set, from moving from -> cell to arrive there at time
+struct MapfConstraint
+{
+    uint32_t agent = 0;
+    uint32_t time = 0;
+    Cell cell;
+    Cell from;
+};
+
+// Multi-agent searches treat mountains as walls (like subgoal graphs) & optionally only move in 4 directions,
+// which is what standard MAPF benchmarks expect
+template<typename Visit>
+void ForEachMapfMove(const Map& map, Cell cell, bool diagonals, Visit visit)
+{
+    for (const Cell& move : MOVES)
+    {
+        if (!diagonals && move.col != 0 && move.row != 0) continue;
+        if (CanStep(map, cell, move))
+            visit(Cell{ cell.col + move.col, cell.row + move.row });
+    }
+}
+
+// Exact cost from every tile to goal, so the low-level search only ever expands states that could be on an optimal path
+vector<float> MapfDistances(const Map& map, Cell goal, bool manhattan, bool diagonals)
+{
+    vector<float> distances(TILE_COUNT * TILE_COUNT, FLT_MAX);
+    using Entry = pair<float, uint32_t>;
+    priority_queue<Entry, vector<Entry>, greater<Entry>> openList;
+    distances[Index(goal)] = 0.0f;
+    openList.push({ 0.0f, (uint32_t)Index(goal) });
+    while (!openList.empty())
+    {
+        const auto [distance, index] = openList.top();
+        openList.pop();
+        if (distance > distances[index]) continue;
+
+        const Cell cell{ int(index % TILE_COUNT), int(index / TILE_COUNT) };
+        ForEachMapfMove(map, cell, diagonals, [&](Cell neighbour)
+        {
+            const float candidate = distance + StepCost(neighbour, cell, map, manhattan);
+            if (candidate < distances[Index(neighbour)])
+            {
+                distances[Index(neighbour)] = candidate;
+                openList.push({ candidate, (uint32_t)Index(neighbour) });
+            }
+        });
+    }
+    return distances;
+}
+
+// How many agents are on each tile at each time step. Agents stay on their goal once their path ends.
+struct ConflictTable
+{
+    void Build(const vector<vector<Cell>>& paths, size_t skip)
+    {
+        horizon = 0;
+        for (const vector<Cell>& path : paths)
+            horizon = max(horizon, (uint32_t)path.size());
+        counts.assign(size_t(horizon + 1) * TILE_COUNT * TILE_COUNT, 0);
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            if (i == skip || paths[i].empty()) continue;
+            for (uint32_t time = 0; time <= horizon; time++)
+                counts[size_t(time) * TILE_COUNT * TILE_COUNT + Index(paths[i][min<size_t>(time, paths[i].size() - 1)])]++;
+        }
+    }
+
+    uint32_t Count(uint32_t time, Cell cell) const
+    {
+        if (counts.empty()) return 0;
+        return counts[size_t(min(time, horizon)) * TILE_COUNT * TILE_COUNT + Index(cell)];
+    }
+
+    vector<uint16_t> counts;
+    uint32_t horizon = 0;
+};
+
+// FindPath's A*, over (tile, time) & respecting agent's constraints. Waiting costs 1 and the path ends on the first
+// arrival at goal that no later constraint forces it off. Equally cheap paths are told apart by how few tiles they share
+// with other agents in table. Returns an empty path if the constraints leave no way to the goal.
+vector<Cell> FindConstrainedPath(const Map& map, Cell start, Cell goal, bool manhattan, bool diagonals,
+    const vector<float>& distances, const vector<MapfConstraint>& constraints, uint32_t agent,
+    const ConflictTable& table, float* cost, size_t* expanded)
+{
+    if (distances[Index(start)] == FLT_MAX) return {};
+
+    const size_t nodeCount = TILE_COUNT * TILE_COUNT;
+    unordered_set<uint64_t> vertexConstraints;
+    unordered_set<uint64_t> edgeConstraints;
+    uint32_t lastConstraint = 0;
+    uint32_t earliestFinish = 0;
+    for (const MapfConstraint& constraint : constraints)
+    {
+        if (constraint.agent != agent) continue;
+        lastConstraint = max(lastConstraint, constraint.time);
+        if (constraint.from.col < 0)
+        {
+            vertexConstraints.insert(constraint.time * nodeCount + Index(constraint.cell));
+            if (constraint.cell == goal)
+                earliestFinish = max(earliestFinish, constraint.time + 1);
+        }
+        else
+        {
+            edgeConstraints.insert((uint64_t(constraint.time) * nodeCount + Index(constraint.from)) * nodeCount + Index(constraint.cell));
+        }
+    }
+
+    // Once past every constraint the goal is as reachable as it is on an empty map, so searching further is pointless
+    const uint32_t horizon = lastConstraint + (uint32_t)nodeCount;
+
+    struct Label
+    {
+        float g;
+        uint32_t conflicts;
+        uint64_t parent;
+    };
+
+    struct State
+    {
+        float f;
+        float g;
+        uint32_t conflicts;
+        uint32_t time;
+        uint32_t index;
+        bool operator>(const State& other) const
+        {
+            if (f != other.f) return f > other.f;
+            if (conflicts != other.conflicts) return conflicts > other.conflicts;
+            return g < other.g;
+        }
+    };
+
+    unordered_map<uint64_t, Label> labels;
+    unordered_set<uint64_t> closedList;
+    priority_queue<State, vector<State>, greater<State>> openList;
+
+    labels[Index(start)] = { 0.0f, 0, UINT64_MAX };
+    openList.push({ distances[Index(start)], 0.0f, 0, 0, (uint32_t)Index(start) });
+
+    while (!openList.empty())
+    {
+        const State state = openList.top();
+        openList.pop();
+        const uint64_t stateKey = state.time * nodeCount + state.index;
+        if (!closedList.insert(stateKey).second) continue;
+        if (expanded != nullptr) (*expanded)++;
+
+        const Cell cell{ int(state.index % TILE_COUNT), int(state.index / TILE_COUNT) };
+        if (cell == goal && state.time >= earliestFinish)
+        {
+            vector<Cell> path(state.time + 1);
+            for (uint64_t current = stateKey; current != UINT64_MAX; current = labels[current].parent)
+            {
+                const size_t index = current % nodeCount;
+                path[current / nodeCount] = { int(index % TILE_COUNT), int(index / TILE_COUNT) };
+            }
+            if (cost != nullptr) *cost = state.g;
+            return path;
+        }
+        if (state.time >= horizon) continue;
+
+        const uint32_t time = state.time + 1;
+        auto expand = [&](Cell next, float stepCost)
+        {
+            if (vertexConstraints.count(time * nodeCount + Index(next))) return;
+            if (edgeConstraints.count((uint64_t(time) * nodeCount + state.index) * nodeCount + Index(next))) return;
+
+            const uint64_t nextKey = time * nodeCount + Index(next);
+            const float gNext = state.g + stepCost;
+            const uint32_t conflictsNext = state.conflicts + table.Count(time, next);
+            auto it = labels.find(nextKey);
+            if (it != labels.end() && (it->second.g < gNext || (it->second.g == gNext && it->second.conflicts <= conflictsNext)))
+                return;
+
+            labels[nextKey] = { gNext, conflictsNext, stateKey };
+            openList.push({ gNext + distances[Index(next)], gNext, conflictsNext, time, (uint32_t)Index(next) });
+        };
+
+        expand(cell, 1.0f);
+        ForEachMapfMove(map, cell, diagonals, [&](Cell next)
+        {
+            expand(next, StepCost(cell, next, map, manhattan));
+        });
+    }
+    return {};
+}
+
+vector<MapfConflict> FindConflicts(const vector<vector<Cell>>& paths)
+{
+    size_t length = 0;
+    for (const vector<Cell>& path : paths)
+        length = max(length, path.size());
+    auto at = [&paths](size_t agent, size_t time) { return paths[agent][min(time, paths[agent].size() - 1)]; };
+
+    vector<MapfConflict> conflicts;
+    vector<int> occupants(TILE_COUNT * TILE_COUNT, -1);
+    for (size_t time = 0; time < length; time++)
+    {
+        for (size_t i = 0; i < paths.size(); i++)
+        {
+            const Cell cell = at(i, time);
+            int& occupant = occupants[Index(cell)];
+            if (occupant >= 0)
+                conflicts.push_back({ (uint32_t)occupant, (uint32_t)i, (uint32_t)time, cell, {}, {}, {}, false });
+            else
+                occupant = (int)i;
+        }
+
+        if (time + 1 < length)
+        {
+            for (size_t i = 0; i < paths.size(); i++)
+            {
+                const Cell cell = at(i, time);
+                const Cell next = at(i, time + 1);
+                if (cell == next) continue;
+
+                const int j = occupants[Index(next)];
+                if (j > (int)i && at(j, time + 1) == cell)
+                    conflicts.push_back({ (uint32_t)i, (uint32_t)j, (uint32_t)time, cell, next, next, cell, true });
+
+                // (0,0) -> (1,1) crosses (1,0) -> (0,1); either end of the other diagonal finds the pair once
+                if (cell.col == next.col || cell.row == next.row) continue;
+                for (const auto& [from, to] : { pair<Cell, Cell>{ { next.col, cell.row }, { cell.col, next.row } },
+                                                pair<Cell, Cell>{ { cell.col, next.row }, { next.col, cell.row } } })
+                {
+                    const int k = occupants[Index(from)];
+                    if (k > (int)i && at(k, time + 1) == to)
+                        conflicts.push_back({ (uint32_t)i, (uint32_t)k, (uint32_t)time, cell, next, from, to, true });
+                }
+            }
+        }
+
+        for (size_t i = 0; i < paths.size(); i++)
+            occupants[Index(at(i, time))] = -1;
+    }
+    return conflicts;
+}
+
+vector<vector<Cell>> PlanCbs(const Map& map, const vector<Cell>& starts, const vector<Cell>& goals, bool manhattan,
+    bool diagonals, double maxMilliseconds, CbsStats* stats)
+{
+    const auto startTime = chrono::steady_clock::now();
+    auto elapsed = [startTime]() { return chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count(); };
+    CbsStats counters;
+    const size_t agentCount = starts.size();
+
+    struct CbsNode
+    {
+        vector<MapfConstraint> constraints;
+        vector<vector<Cell>> paths;
+        vector<float> costs;
+        float cost = 0.0f;
+    };
+
+    vector<vector<float>> distances;
+    for (const Cell& goal : goals)
+        distances.push_back(MapfDistances(map, goal, manhattan, diagonals));
+
+    ConflictTable table;
+    auto replan = [&](const CbsNode& node, const vector<MapfConstraint>& constraints, uint32_t agent, float& cost)
+    {
+        counters.lowLevelSearches++;
+        table.Build(node.paths, agent);
+        cost = FLT_MAX;
+        return FindConstrainedPath(map, starts[agent], goals[agent], manhattan, diagonals, distances[agent], constraints,
+            agent, table, &cost, &counters.lowLevelExpanded);
+    };
+
+    // Plan everyone in turn, each avoiding the agents before it where that's free
+    CbsNode root;
+    root.paths.resize(agentCount);
+    root.costs.resize(agentCount);
+    bool feasible = true;
+    for (uint32_t i = 0; i < agentCount && feasible; i++)
+    {
+        root.paths[i] = replan(root, root.constraints, i, root.costs[i]);
+        root.cost += root.costs[i];
+        feasible = !root.paths[i].empty();
+    }
+
+    // Ordered by cost, then by number of conflicts
+    using Entry = tuple<float, size_t, size_t>;
+    priority_queue<Entry, vector<Entry>, greater<Entry>> openList;
+    vector<CbsNode> nodes;
+    if (feasible)
+    {
+        openList.push({ root.cost, FindConflicts(root.paths).size(), 0 });
+        nodes.push_back(move(root));
+        counters.generatedNodes++;
+    }
+
+    vector<vector<Cell>> solution;
+    while (!openList.empty() && solution.empty() && elapsed() < maxMilliseconds)
+    {
+        CbsNode node = move(nodes[get<2>(openList.top())]);
+        openList.pop();
+        counters.expandedNodes++;
+
+        // Children of the conflict to split on: the constraint each adds, & the replanned path it leads to
+        struct Child
+        {
+            MapfConstraint constraint;
+            vector<Cell> path;
+            float cost;
+        };
+
+        bool bypassed = true;
+        array<Child, 2> split;
+        while (bypassed)
+        {
+            bypassed = false;
+            const vector<MapfConflict> conflicts = FindConflicts(node.paths);
+            if (conflicts.empty())
+            {
+                solution = node.paths;
+                counters.solved = true;
+                counters.cost = node.cost;
+                break;
+            }
+
+            int bestKind = -1;
+            for (const MapfConflict& conflict : conflicts)
+            {
+                array<Child, 2> children;
+                children[0].constraint = { conflict.a, conflict.time, conflict.cell, {} };
+                children[1].constraint = { conflict.b, conflict.time, conflict.cell, {} };
+                if (conflict.edge)
+                {
+                    children[0].constraint = { conflict.a, conflict.time + 1, conflict.other, conflict.cell };
+                    children[1].constraint = { conflict.b, conflict.time + 1, conflict.otherTo, conflict.otherFrom };
+                }
+
+                // Cardinal conflicts (kind 2) raise the cost of both children, semi-cardinal ones (kind 1) just one
+                int kind = 0;
+                for (Child& child : children)
+                {
+                    const uint32_t agent = child.constraint.agent;
+                    vector<MapfConstraint> constraints = node.constraints;
+                    constraints.push_back(child.constraint);
+                    child.path = replan(node, constraints, agent, child.cost);
+                    if (child.cost > node.costs[agent] + 1e-4f)
+                    {
+                        kind++;
+                        continue;
+                    }
+
+                    // Same cost & fewer conflicts: take the path without splitting
+                    vector<Cell> previous = move(node.paths[agent]);
+                    node.paths[agent] = child.path;
+                    if (FindConflicts(node.paths).size() < conflicts.size())
+                    {
+                        node.costs[agent] = child.cost;
+                        counters.bypasses++;
+                        bypassed = true;
+                        break;
+                    }
+                    node.paths[agent] = move(previous);
+                }
+                if (bypassed) break;
+
+                if (kind > bestKind)
+                {
+                    bestKind = kind;
+                    split = move(children);
+                }
+                if (kind == 2 || elapsed() >= maxMilliseconds) break;
+            }
+        }
+        if (!solution.empty()) break;
+
+        for (Child& child : split)
+        {
+            if (child.path.empty()) continue;
+
+            const uint32_t agent = child.constraint.agent;
+            CbsNode next;
+            next.constraints = node.constraints;
+            next.constraints.push_back(child.constraint);
+            next.paths = node.paths;
+            next.paths[agent] = move(child.path);
+            next.costs = node.costs;
+            next.costs[agent] = child.cost;
+            next.cost = node.cost - node.costs[agent] + child.cost;
+
+            openList.push({ next.cost, FindConflicts(next.paths).size(), nodes.size() });
+            nodes.push_back(move(next));
+            counters.generatedNodes++;
+        }
+    }
+
+    if (stats != nullptr)
+    {
+        counters.milliseconds = elapsed();
+        *stats = counters;
+    }
+    return solution;
+}
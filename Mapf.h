@@ -0,0 +1,54 @@
+#pragma once
+#include "Grid.h"
+#define RESERVATION_WINDOW 16
+
+struct CooperativeStats
+{
+    size_t expanded = 0;
+    size_t windows = 0;
+    size_t failedSearches = 0;  // Agents that found no way through the reservations and had to wait in place
+    bool allArrived = false;
+    double milliseconds = 0.0;
+};
+
+// Windowed Hierarchical Cooperative A* for a whole group in one call. Each window, agents plan RESERVATION_WINDOW
+// steps ahead in priority order, reserving their space-time tiles as they go; everyone then executes half the window
+// and the next window replans with the priorities rotated. Returns one timed path per agent.
+vector<vector<Cell>> PlanCooperative(const Map& map, const vector<Cell>& starts, const vector<Cell>& goals, bool manhattan,
+    size_t maxWindows = 64, CooperativeStats* stats = nullptr);
+
+// Two agents on the same tile at time, or (edge) a moving cell -> other while b moves otherFrom -> otherTo from time to
+// time + 1, either back along the same edge or diagonally across it
+struct MapfConflict
+{
+    uint32_t a = 0;
+    uint32_t b = 0;
+    uint32_t time = 0;
+    Cell cell;
+    Cell other;
+    Cell otherFrom;
+    Cell otherTo;
+    bool edge = false;
+};
+
+struct CbsStats
+{
+    size_t expandedNodes = 0;
+    size_t generatedNodes = 0;
+    size_t bypasses = 0;
+    size_t lowLevelSearches = 0;
+    size_t lowLevelExpanded = 0;
+    float cost = 0.0f;  // Sum of path costs
+    bool solved = false;
+    double milliseconds = 0.0;
+};
+
+// Every vertex & edge conflict between pairs of paths, counting diagonal moves that cross as edge conflicts
+vector<MapfConflict> FindConflicts(const vector<vector<Cell>>& paths);
+
+// Conflict-Based Search for sum-of-costs optimal, collision-free paths, with the ICBS improvements: conflicts that
+// raise both agents' costs (cardinal) are split on first, then semi-cardinal ones, and a child that resolves a
+// conflict without raising the cost or adding conflicts is adopted in place of splitting (bypassing). Returns no
+// paths if it runs out of time.
+vector<vector<Cell>> PlanCbs(const Map& map, const vector<Cell>& starts, const vector<Cell>& goals, bool manhattan,
+    bool diagonals, double maxMilliseconds, CbsStats* stats = nullptr);
@@ -0,0 +1,191 @@
+#pragma once
+#include "Grid.h"
+#include <queue>
+#include <chrono>
+
+// Lifelong Planning A* for one start/goal pair. It keeps g & rhs values between searches, so after tiles change only
+// the part of the search those changes affect is redone. Uses FindPath's costs & heuristics.
+struct PathRepair
+{
+    using Key = pair<float, float>;
+
+    void Reset(Cell start, Cell goal, bool manhattan)
+    {
+        this->start = start;
+        this->goal = goal;
+        this->manhattan = manhattan;
+        g.assign(TILE_COUNT * TILE_COUNT, FLT_MAX);
+        rhs.assign(TILE_COUNT * TILE_COUNT, FLT_MAX);
+        keys.assign(TILE_COUNT * TILE_COUNT, { FLT_MAX, FLT_MAX });
+        inOpen.assign(TILE_COUNT * TILE_COUNT, false);
+        openList = {};
+        rhs[Index(start)] = 0.0f;
+        Insert(start);
+    }
+
+    // Picks up where an A* search between the same tiles on map left off, rather than searching it all over again.
+    // Its nodes' g values are real path costs, exact for expanded tiles, so only tiles that disagree with their
+    // neighbours (the edge of that search) go on the open list.
+    void Seed(const Map& map, const vector<Node>& nodes)
+    {
+        vector<bool> seen(g.size(), false);
+        for (size_t index = 0; index < nodes.size(); index++)
+        {
+            if (nodes[index].cell.col >= 0)
+                g[index] = nodes[index].g;
+        }
+        for (size_t index = 0; index < nodes.size(); index++)
+        {
+            if (nodes[index].cell.col < 0) continue;
+
+            const Cell cell = nodes[index].cell;
+            for (int move = 0; move <= (int)MOVES.size(); move++)
+            {
+                const Cell other = move < (int)MOVES.size() ? Cell{ cell.col + MOVES[move].col, cell.row + MOVES[move].row } : cell;
+                if (!InBounds(other) || seen[Index(other)]) continue;
+                seen[Index(other)] = true;
+                UpdateVertex(map, other);
+            }
+        }
+    }
+
+    bool Matches(Cell start, Cell goal, bool manhattan) const
+    {
+        return !g.empty() && this->start == start && this->goal == goal && this->manhattan == manhattan;
+    }
+
+    // Stepping onto a tile costs its terrain, so a changed tile only changes the edges into it
+    void TilesChanged(const Map& map, const vector<Cell>& cells)
+    {
+        for (const Cell& cell : cells)
+            UpdateVertex(map, cell);
+    }
+
+    vector<Cell> ComputePath(const Map& map, SearchStats* stats = nullptr)
+    {
+        SearchStats counters;
+        const auto startTime = chrono::steady_clock::now();
+        const size_t startBytes = gBytesAllocated;
+        const size_t goalIndex = Index(goal);
+
+        while (!openList.empty())
+        {
+            const size_t index = openList.top().second;
+            const Key key = openList.top().first;
+            if (!inOpen[index] || key != keys[index])
+            {
+                openList.pop();
+                counters.stalePops++;
+                continue;
+            }
+            if (!(key < CalculateKey(goal)) && rhs[goalIndex] == g[goalIndex])
+                break;
+
+            openList.pop();
+            inOpen[index] = false;
+            counters.expanded++;
+
+            const Cell cell{ int(index % TILE_COUNT), int(index / TILE_COUNT) };
+            if (g[index] > rhs[index])
+            {
+                g[index] = rhs[index];
+            }
+            else
+            {
+                g[index] = FLT_MAX;
+                UpdateVertex(map, cell);
+            }
+            for (const Cell& move : MOVES)
+            {
+                const Cell neighbour{ cell.col + move.col, cell.row + move.row };
+                if (InBounds(neighbour))
+                    UpdateVertex(map, neighbour);
+            }
+            counters.peakOpen = max(counters.peakOpen, openList.size());
+        }
+
+        // Walk back from the goal through whichever neighbour it's cheapest to have come from
+        vector<Cell> path;
+        if (g[goalIndex] < FLT_MAX)
+        {
+            Cell current = goal;
+            path.push_back(current);
+            while (!(current == start) && path.size() <= TILE_COUNT * TILE_COUNT)
+            {
+                Cell best = current;
+                float bestCost = FLT_MAX;
+                for (const Cell& neighbour : Neighbours(current))
+                {
+                    const float gNeighbour = g[Index(neighbour)];
+                    if (gNeighbour == FLT_MAX) continue;
+                    const float cost = gNeighbour + StepCost(neighbour, current, map, manhattan);
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        best = neighbour;
+                    }
+                }
+                if (best == current) break;
+                current = best;
+                path.push_back(current);
+            }
+            reverse(path.begin(), path.end());
+        }
+
+        if (stats != nullptr)
+        {
+            counters.bytesAllocated = gBytesAllocated - startBytes;
+            counters.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+            *stats = counters;
+        }
+        return path;
+    }
+
+    Key CalculateKey(Cell cell) const
+    {
+        const float best = min(g[Index(cell)], rhs[Index(cell)]);
+        if (best == FLT_MAX) return { FLT_MAX, FLT_MAX };
+        const float h = manhattan ? Manhattan(cell, goal) : Euclidean(cell, goal);
+        return { best + h, best };
+    }
+
+    void Insert(Cell cell)
+    {
+        const size_t index = Index(cell);
+        keys[index] = CalculateKey(cell);
+        inOpen[index] = true;
+        openList.push({ keys[index], index });
+    }
+
+    void UpdateVertex(const Map& map, Cell cell)
+    {
+        const size_t index = Index(cell);
+        if (!(cell == start))
+        {
+            float best = FLT_MAX;
+            for (const Cell& move : MOVES)
+            {
+                const Cell neighbour{ cell.col + move.col, cell.row + move.row };
+                if (!InBounds(neighbour)) continue;
+                const float gNeighbour = g[Index(neighbour)];
+                if (gNeighbour < FLT_MAX)
+                    best = min(best, gNeighbour + StepCost(neighbour, cell, map, manhattan));
+            }
+            rhs[index] = best;
+        }
+
+        // Removal from the open list is lazy: stale entries are skipped when popped
+        inOpen[index] = false;
+        if (g[index] != rhs[index])
+            Insert(cell);
+    }
+
+    Cell start;
+    Cell goal;
+    bool manhattan = true;
+    vector<float> g;
+    vector<float> rhs;
+    vector<Key> keys;
+    vector<bool> inOpen;
+    priority_queue<pair<Key, size_t>, vector<pair<Key, size_t>>, greater<pair<Key, size_t>>> openList;
+};
@@ -0,0 +1,59 @@
+#include "ProfileCache.h"
+
+vector<Cell> FindPath(Cell start, Cell end, const ProfileCache& profile, bool manhattan, SearchStats* stats,
+    SearchTrace* trace, int agentSize, float weight)
+{
+    if (!profile.Connected(start, end))
+    {
+        if (stats != nullptr)
+            *stats = {};
+        if (trace != nullptr)
+            trace->Clear();
+        return {};
+    }
+
+    const float* costs = profile.tileCosts.data();
+    auto tileCost = [costs](Cell cell) { return costs[Index(cell)]; };
+    return SearchGrid(start, SingleGoal{ end, profile.minCost, manhattan }, tileCost, manhattan, stats, trace,
+        agentSize > 1 ? &profile.clearance : nullptr, agentSize, weight);
+}
+
+vector<Cell> FindAnyAnglePath(Cell start, Cell end, const ProfileCache& profile, bool lazy, SearchStats* stats,
+    int agentSize, float weight)
+{
+    if (!profile.Connected(start, end))
+    {
+        if (stats != nullptr)
+            *stats = {};
+        return {};
+    }
+
+    const float* costs = profile.tileCosts.data();
+    auto tileCost = [costs](Cell cell) { return costs[Index(cell)]; };
+    return SearchAnyAngle(start, end, tileCost, profile.minCost, lazy, stats,
+        agentSize > 1 ? &profile.clearance : nullptr, agentSize, weight);
+}
+
+vector<Cell> FindPath(Cell start, const vector<Cell>& goals, const ProfileCache& profile, bool manhattan,
+    SearchStats* stats, SearchTrace* trace, int agentSize)
+{
+    vector<Cell> reachable;
+    for (const Cell& goal : goals)
+    {
+        if (profile.Connected(start, goal))
+            reachable.push_back(goal);
+    }
+    if (reachable.empty())
+    {
+        if (stats != nullptr)
+            *stats = {};
+        if (trace != nullptr)
+            trace->Clear();
+        return {};
+    }
+
+    const float* costs = profile.tileCosts.data();
+    auto tileCost = [costs](Cell cell) { return costs[Index(cell)]; };
+    return SearchGrid(start, GoalSet(reachable, profile.minCost, manhattan), tileCost, manhattan, stats, trace,
+        agentSize > 1 ? &profile.clearance : nullptr, agentSize);
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include "Grid.h"
+#include "Search.h"
+#include "Wavefront.h"
+#include "SubgoalGraph.h"
+
+// Everything precomputed for searching one movement profile's view of the map. Kept up to date on edits, except subgoal
+// graphs, which are built the first time each size class asks for one on a map version.
+struct ProfileCache
+{
+    void Build(const Map& map, uint64_t version, int id)
+    {
+        profile = id;
+        minCost = FLT_MAX;
+        for (float cost : MovementProfiles()[profile].costs)
+        {
+            if (cost != IMPASSABLE)
+                minCost = min(minCost, cost);
+        }
+        if (minCost == FLT_MAX)
+            minCost = 0.0f;
+
+        tileCosts.resize(TILE_COUNT * TILE_COUNT);
+        blockedMap = map;
+        for (int row = 0; row < TILE_COUNT; row++)
+        {
+            for (int col = 0; col < TILE_COUNT; col++)
+                Recost(map, { col, row });
+        }
+        clearance.Build(blockedMap);
+        BuildComponents();
+        mapVersion = version;
+    }
+
+    void Update(const Map& map, uint64_t version, const vector<Cell>& changed)
+    {
+        for (const Cell& cell : changed)
+            Recost(map, cell);
+        clearance.Update(blockedMap, changed);
+        BuildComponents();
+        mapVersion = version;
+    }
+
+    void Recost(const Map& map, Cell cell)
+    {
+        const TileType type = (TileType)map[cell.row][cell.col];
+        const float cost = MovementProfiles()[profile].costs[type];
+        tileCosts[Index(cell)] = cost;
+        blockedMap[cell.row][cell.col] = cost == IMPASSABLE ? MOUNTAIN : type;
+    }
+
+    // 8-connected flood fills over enterable tiles, matching the moves FindPath makes. Flooding a wavefront doesn't reset
+    // what it's visited, so each tile is only ever reached once however many components there are.
+    void BuildComponents()
+    {
+        const TileBits passable = PackTiles([this](Cell cell) { return tileCosts[Index(cell)] != IMPASSABLE; });
+        components.assign(TILE_COUNT * TILE_COUNT, NO_COMPONENT);
+        uint32_t count = 0;
+        Wavefront wavefront;
+        for (size_t index = 0; index < components.size(); index++)
+        {
+            if (components[index] != NO_COMPONENT || tileCosts[index] == IMPASSABLE) continue;
+
+            const Cell start{ int(index % TILE_COUNT), int(index / TILE_COUNT) };
+            wavefront.Expand(passable, start, true, [&](size_t reached, uint32_t) { components[reached] = count; return true; });
+            count++;
+        }
+    }
+
+    bool Connected(Cell a, Cell b) const
+    {
+        return components[Index(a)] != NO_COMPONENT && components[Index(a)] == components[Index(b)];
+    }
+
+    // Subgoal graph for agents of the given size, along with the map it was built on
+    const SubgoalGraph& Subgoals(int size)
+    {
+        SubgoalGraph& graph = subgoalGraphs[size - 1];
+        if (graph.mapVersion != mapVersion || graph.Empty())
+        {
+            sizeClassMaps[size - 1] = SizeClassMap(blockedMap, clearance, size);
+            graph = BuildSubgoalGraph(sizeClassMaps[size - 1], mapVersion);
+        }
+        return graph;
+    }
+
+    static constexpr uint32_t NO_COMPONENT = UINT32_MAX;
+
+    int profile = STANDARD_PROFILE;
+    uint64_t mapVersion = 0;
+    vector<float> tileCosts;        // Terrain cost of entering each tile, IMPASSABLE where the profile can't go
+    float minCost = 0.0f;           // Cheapest terrain the profile can enter, for the heuristic
+    vector<uint32_t> components;    // Tiles in different components can't reach each other, so there's nothing to search
+
+    // Tiles the profile can't enter turned into mountains, which is what clearance & subgoal graphs treat as walls
+    Map blockedMap;
+    ClearanceMap clearance;
+    vector<Map> sizeClassMaps = vector<Map>(MAX_AGENT_SIZE);
+    vector<SubgoalGraph> subgoalGraphs = vector<SubgoalGraph>(MAX_AGENT_SIZE);
+};
+
+// FindPath for one movement profile. Starts or goals the profile can't stand on, or in another component, fail without
+// searching.
+vector<Cell> FindPath(Cell start, Cell end, const ProfileCache& profile, bool manhattan, SearchStats* stats = nullptr,
+    SearchTrace* trace = nullptr, int agentSize = 1, float weight = 1.0f);
+
+// FindAnyAnglePath for one movement profile & agent size, failing without searching the same way FindPath does
+vector<Cell> FindAnyAnglePath(Cell start, Cell end, const ProfileCache& profile, bool lazy, SearchStats* stats = nullptr,
+    int agentSize = 1, float weight = 1.0f);
+
+// enterCost for LineCost & SmoothPath as an agent of agentSize with this profile sees the map: terrain it can't enter &
+// gaps too narrow for it are IMPASSABLE, the same way SearchAnyAngle checks its lines
+inline auto ProfileEnterCost(const ProfileCache& profile, int agentSize)
+{
+    const ClearanceMap* clearance = agentSize > 1 ? &profile.clearance : nullptr;
+    const float* costs = profile.tileCosts.data();
+    return [clearance, costs, agentSize](Cell from, Cell to)
+    {
+        if (clearance != nullptr && !clearance->Fits(from, to, agentSize)) return IMPASSABLE;
+        return costs[Index(to)];
+    };
+}
+
+// Path to whichever of goals is cheapest to reach, in a single search. Goals in another component are dropped up front.
+vector<Cell> FindPath(Cell start, const vector<Cell>& goals, const ProfileCache& profile, bool manhattan,
+    SearchStats* stats = nullptr, SearchTrace* trace = nullptr, int agentSize = 1);
@@ -0,0 +1,132 @@
+#include "QueryLog.h"
+#include <cstring>
+
+bool LoadQueryLog(const char* path, vector<Map>& maps, vector<LoggedQuery>& queries)
+{
+    ifstream file(path, ios::binary);
+    char magic[4];
+    uint32_t format, tileCount;
+    if (!file.read(magic, sizeof(magic)) || memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0 ||
+        !Read(file, format) || format < 1 || format > LOG_FORMAT)
+    {
+        printf("%s is not a query log\n", path);
+        return false;
+    }
+    if (!Read(file, tileCount) || tileCount != TILE_COUNT)
+    {
+        printf("%s was recorded with TILE_COUNT %u, this build uses %i\n", path, tileCount, TILE_COUNT);
+        return false;
+    }
+
+    // Any record cut short or holding a value this build can't replay rejects the whole log, rather than replaying
+    // garbage tiles or indexing off the map
+    auto corrupt = [&](const char* what)
+    {
+        printf("Corrupt record in %s (%s), rejecting it\n", path, what);
+        maps.clear();
+        queries.clear();
+        return false;
+    };
+
+    vector<uint64_t> versions;
+    uint8_t tag;
+    while (Read(file, tag))
+    {
+        uint64_t version;
+        if (!Read(file, version)) return corrupt("truncated record");
+
+        if (tag == 'M')
+        {
+            Map map;
+            for (auto& row : map)
+            {
+                for (size_t& tile : row)
+                {
+                    uint8_t type = 0;
+                    if (!Read(file, type)) return corrupt("truncated map");
+                    if (type >= COUNT) return corrupt("unknown tile type");
+                    tile = type;
+                }
+            }
+            versions.push_back(version);
+            maps.push_back(map);
+        }
+        else if (tag == 'Q')
+        {
+            LoggedQuery query;
+            uint16_t startCol, startRow, goalCol, goalRow;
+            uint8_t mode;
+            if (!Read(file, query.milliseconds) || !Read(file, startCol) || !Read(file, startRow) ||
+                !Read(file, goalCol) || !Read(file, goalRow) || !Read(file, mode))
+                return corrupt("truncated query");
+
+            PathRequest& request = query.request;
+            uint8_t profile = STANDARD_PROFILE, agentSize = 1, shape = GRID_PATH, flags = 0;
+            int8_t nearest = -1;
+            if (format >= 2 && (!Read(file, profile) || !Read(file, agentSize) || !Read(file, request.weight) ||
+                !Read(file, shape) || !Read(file, flags) || !Read(file, nearest)))
+                return corrupt("truncated query");
+
+            auto it = find(versions.rbegin(), versions.rend(), version);
+            if (it == versions.rend()) return corrupt("query against unknown map version");
+            query.map = versions.rend() - it - 1;
+            request.start = { startCol, startRow };
+            request.goal = { goalCol, goalRow };
+            request.manhattan = mode == MANHATTAN_MODE;
+            request.profile = profile;
+            request.agentSize = agentSize;
+            request.shape = shape;
+            request.smooth = flags & SMOOTH_QUERY;
+            request.anytime = flags & ANYTIME_QUERY;
+            request.useCpd = flags & CPD_QUERY;
+            request.useSubgoals = flags & SUBGOAL_QUERY;
+            request.nearest = nearest;
+            if (!InBounds(request.start) || !InBounds(request.goal)) return corrupt("query off the map");
+            if (mode > MANHATTAN_MODE) return corrupt("unknown query mode");
+            if (profile >= PROFILE_COUNT) return corrupt("unknown movement profile");
+            if (agentSize < 1 || agentSize > MAX_AGENT_SIZE) return corrupt("agent size out of range");
+            if (!(request.weight >= 1.0f && request.weight <= 100.0f)) return corrupt("heuristic weight out of range");
+            if (shape > LAZY_THETA_PATH) return corrupt("unknown path shape");
+            if (flags & ~(SMOOTH_QUERY | ANYTIME_QUERY | CPD_QUERY | SUBGOAL_QUERY)) return corrupt("unknown query flags");
+            if (nearest < -1 || nearest >= (int)COUNT) return corrupt("unknown nearest tile type");
+            queries.push_back(query);
+        }
+        else
+        {
+            return corrupt("unknown record");
+        }
+    }
+    return true;
+}
+
+vector<Cell> FindRequestPath(const PathRequest& request, const Map& map, ProfileCache& profile, SearchStats* stats,
+    SearchTrace* trace)
+{
+    const int size = request.agentSize;
+    if (request.nearest >= 0)
+    {
+        vector<Cell> goals;
+        for (int row = 0; row < TILE_COUNT; row++)
+        {
+            for (int col = 0; col < TILE_COUNT; col++)
+            {
+                if (map[row][col] == (size_t)request.nearest)
+                    goals.push_back({ col, row });
+            }
+        }
+        return FindPath(request.start, goals, profile, request.manhattan, stats, trace, size);
+    }
+    if (request.useSubgoals)
+    {
+        const SubgoalGraph& graph = profile.Subgoals(size);
+        return FindPath(request.start, request.goal, profile.sizeClassMaps[size - 1], graph, stats);
+    }
+    if (request.shape != GRID_PATH)
+        return FindAnyAnglePath(request.start, request.goal, profile, request.shape == LAZY_THETA_PATH, stats, size, request.weight);
+    return FindPath(request.start, request.goal, profile, request.manhattan, stats, trace, size, request.weight);
+}
+
+bool UsesAnytime(const PathRequest& request)
+{
+    return request.anytime && request.nearest < 0 && !request.useSubgoals && request.shape == GRID_PATH;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include "ProfileCache.h"
+#include <chrono>
+
+// Whether grid searches step between neighbouring tiles or cut straight across them
+enum PathShape : int
+{
+    GRID_PATH,
+    THETA_PATH,
+    LAZY_THETA_PATH
+};
+
+// A path query as set up in the UI
+struct PathRequest
+{
+    Cell start;
+    Cell goal;
+    bool manhattan = true;
+    bool useCpd = false;
+    bool useSubgoals = false;
+    int shape = GRID_PATH;
+    bool smooth = false;    // String-pull the result into waypoints
+    int agentSize = 1;      // Tiles across, anchored at the agent's top-left tile
+    int profile = STANDARD_PROFILE;
+    float weight = 1.0f;    // Heuristic weight for grid searches, or the starting weight for anytime ones
+    bool anytime = false;   // Keep improving the path with ARA* after the first one is found
+    int nearest = -1;       // Head for the nearest tile of this type instead of the goal, -1 for the goal
+};
+
+// Binary query log. A map record is written whenever the map version changes, followed by the queries made against it.
+// Layout: header { "SQLG", u32 format, u32 TILE_COUNT }, then records tagged 'M' { u64 version, TILE_COUNT^2 x u8 tile }
+// or 'Q' { u64 version, u32 milliseconds, u16 start col/row, u16 goal col/row, u8 mode, u8 profile, u8 agent size,
+// f32 weight, u8 shape, u8 flags, i8 nearest tile type }. Format 1 queries stop after the mode & replay as plain A*.
+constexpr char LOG_MAGIC[4] = { 'S', 'Q', 'L', 'G' };
+constexpr uint32_t LOG_FORMAT = 2;
+
+enum QueryMode : uint8_t
+{
+    EUCLIDEAN_MODE,
+    MANHATTAN_MODE
+};
+
+enum QueryFlags : uint8_t
+{
+    SMOOTH_QUERY = 1 << 0,
+    ANYTIME_QUERY = 1 << 1,
+    CPD_QUERY = 1 << 2,
+    SUBGOAL_QUERY = 1 << 3
+};
+
+struct QueryLog
+{
+    bool Open(const char* path)
+    {
+        file.open(path, ios::binary | ios::trunc);
+        if (!file.is_open()) return false;
+
+        file.write(LOG_MAGIC, sizeof(LOG_MAGIC));
+        Write<uint32_t>(file, LOG_FORMAT);
+        Write<uint32_t>(file, TILE_COUNT);
+        opened = chrono::steady_clock::now();
+        hasMap = false;
+        return true;
+    }
+
+    void Close()
+    {
+        file.close();
+    }
+
+    void Record(const Map& map, uint64_t version, const PathRequest& request)
+    {
+        if (!file.is_open()) return;
+
+        if (!hasMap || version != mapVersion)
+        {
+            Write<uint8_t>(file, 'M');
+            Write<uint64_t>(file, version);
+            for (const auto& row : map)
+                for (size_t tile : row)
+                    Write<uint8_t>(file, (uint8_t)tile);
+            mapVersion = version;
+            hasMap = true;
+        }
+
+        Write<uint8_t>(file, 'Q');
+        Write<uint64_t>(file, version);
+        Write<uint32_t>(file, (uint32_t)chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - opened).count());
+        Write<uint16_t>(file, (uint16_t)request.start.col);
+        Write<uint16_t>(file, (uint16_t)request.start.row);
+        Write<uint16_t>(file, (uint16_t)request.goal.col);
+        Write<uint16_t>(file, (uint16_t)request.goal.row);
+        Write<uint8_t>(file, request.manhattan ? MANHATTAN_MODE : EUCLIDEAN_MODE);
+        Write<uint8_t>(file, (uint8_t)request.profile);
+        Write<uint8_t>(file, (uint8_t)request.agentSize);
+        Write<float>(file, request.weight);
+        Write<uint8_t>(file, (uint8_t)request.shape);
+        Write<uint8_t>(file, (request.smooth ? SMOOTH_QUERY : 0) | (request.anytime ? ANYTIME_QUERY : 0) |
+            (request.useCpd ? CPD_QUERY : 0) | (request.useSubgoals ? SUBGOAL_QUERY : 0));
+        Write<int8_t>(file, (int8_t)request.nearest);
+        file.flush();
+    }
+
+    ofstream file;
+    chrono::steady_clock::time_point opened;
+    uint64_t mapVersion = 0;
+    bool hasMap = false;
+};
+
+struct LoggedQuery
+{
+    size_t map;             // Index into the replay's map list
+    uint32_t milliseconds;
+    PathRequest request;    // useCpd is whether a CPD actually answered it, not just whether one was asked for
+};
+
+bool LoadQueryLog(const char* path, vector<Map>& maps, vector<LoggedQuery>& queries);
+
+// Answers a request the way the app does, short of CPD lookups & anytime searches, which need state kept between
+// queries. Only grid searches fill in trace.
+vector<Cell> FindRequestPath(const PathRequest& request, const Map& map, ProfileCache& profile, SearchStats* stats = nullptr,
+    SearchTrace* trace = nullptr);
+
+// The anytime option only applies to plain grid searches; FindRequestPath answers the rest
+bool UsesAnytime(const PathRequest& request);
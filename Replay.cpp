@@ -0,0 +1,305 @@
+#include "Replay.h"
+#include "QueryLog.h"
+#include "Cpd.h"
+#include "BoundedSearch.h"
+#include "AnytimeSearch.h"
+#include <functional>
+#include <algorithm>
+
+// What the queries replayed through one config share: the logged maps, & whatever that config has built for them. Each
+// is built the first time a query needs it, so that query pays for the build, as it would in the app.
+struct ReplayState
+{
+    explicit ReplayState(const vector<Map>& maps)
+        : maps(maps)
+    {
+    }
+
+    const Map& MapOf(const LoggedQuery& q) const
+    {
+        return maps[q.map];
+    }
+
+    ProfileCache& Profile(const LoggedQuery& q)
+    {
+        ProfileCache& profile = profiles[q.map * PROFILE_COUNT + q.request.profile];
+        if (profile.tileCosts.empty())
+            profile.Build(maps[q.map], MapVersion(maps[q.map]), q.request.profile);
+        return profile;
+    }
+
+    const CompressedPathDatabase& Cpd(const LoggedQuery& q)
+    {
+        CompressedPathDatabase& cpd = cpds[q.map * 2 + (q.request.manhattan ? 1 : 0)];
+        if (cpd.Empty())
+            cpd = BuildCompressedPathDatabase(maps[q.map], MapVersion(maps[q.map]), q.request.manhattan);
+        return cpd;
+    }
+
+    const TileBits& Passable(const LoggedQuery& q)
+    {
+        auto passable = passables.find(q.map * PROFILE_COUNT + q.request.profile);
+        if (passable == passables.end())
+        {
+            const Map& blocked = Profile(q).blockedMap;
+            passable = passables.emplace(q.map * PROFILE_COUNT + q.request.profile,
+                PackTiles([&blocked](Cell cell) { return !Blocked(blocked, cell); })).first;
+        }
+        return passable->second;
+    }
+
+    const vector<Map>& maps;
+    unordered_map<size_t, ProfileCache> profiles;           // By map * PROFILE_COUNT + profile
+    unordered_map<size_t, CompressedPathDatabase> cpds;     // By map * 2 + manhattan
+    unordered_map<size_t, TileBits> passables;              // By map * PROFILE_COUNT + profile
+    Wavefront wavefront;
+    BoundedSearchMemory memory{ BOUNDED_SEARCH_BYTES };
+};
+
+// One config's answer to a logged query. Configs that can't answer a query at all (a CPD asked about a boat, say) skip
+// it. exact says the path is meant to be optimal for the query as logged; only those results are compared. A partial
+// path stops short of the goal, & is counted rather than compared.
+struct ReplayResult
+{
+    vector<Cell> path;
+    bool answered = true;
+    bool exact = false;
+    bool partial = false;
+};
+
+// A way of answering a logged query. "logged" replays each query exactly as it was made in the app, the others swap the
+// planner while keeping the query's profile, agent size & target where they can.
+struct PlannerConfig
+{
+    const char* name;
+    function<ReplayResult(const LoggedQuery&, ReplayState&)> plan;
+};
+
+// A CPD only answers single-tile standard-cost queries for a goal
+bool StandardGoalQuery(const PathRequest& request)
+{
+    return request.profile == STANDARD_PROFILE && request.agentSize == 1 && request.nearest < 0;
+}
+
+vector<PlannerConfig> PlannerConfigs()
+{
+    auto logged = [](const LoggedQuery& q, ReplayState& state)
+    {
+        const PathRequest& request = q.request;
+        ProfileCache& profile = state.Profile(q);
+        vector<Cell> path;
+        if (request.useCpd)
+        {
+            path = FindPath(request.start, request.goal, state.Cpd(q));
+        }
+        else if (UsesAnytime(request))
+        {
+            // Every pass runs back to back, keeping the last path, which is the one the app ends up showing
+            AnytimeSearch search;
+            search.Reset(request.start, request.goal, profile, request.manhattan, request.agentSize, request.weight);
+            vector<Cell> pass;
+            SearchStats stats;
+            while (search.Running())
+            {
+                if (search.Improve(ANYTIME_TIME_LIMIT, pass, stats))
+                    path = pass;
+            }
+        }
+        else
+        {
+            path = FindRequestPath(request, state.MapOf(q), profile);
+        }
+        if (request.smooth)
+            path = SmoothPath(path, ProfileEnterCost(profile, request.agentSize));
+        const bool exact = request.weight == 1.0f && request.shape == GRID_PATH && !request.useSubgoals && !request.smooth;
+        return ReplayResult{ path, true, exact };
+    };
+
+    // The query as plain A*, other options dropped
+    auto plain = [](const LoggedQuery& q)
+    {
+        PathRequest request = q.request;
+        request.shape = GRID_PATH;
+        request.useSubgoals = false;
+        request.weight = 1.0f;
+        return request;
+    };
+
+    auto heuristic = [plain](bool manhattan)
+    {
+        return [plain, manhattan](const LoggedQuery& q, ReplayState& state)
+        {
+            PathRequest request = plain(q);
+            request.manhattan = manhattan;
+            return ReplayResult{ FindRequestPath(request, state.MapOf(q), state.Profile(q)), true, manhattan == q.request.manhattan };
+        };
+    };
+
+    auto cpd = [](const LoggedQuery& q, ReplayState& state)
+    {
+        if (!StandardGoalQuery(q.request)) return ReplayResult{ {}, false };
+        return ReplayResult{ FindPath(q.request.start, q.request.goal, state.Cpd(q)), true, true };
+    };
+
+    auto subgoal = [](const LoggedQuery& q, ReplayState& state)
+    {
+        if (q.request.nearest >= 0) return ReplayResult{ {}, false };
+        ProfileCache& profile = state.Profile(q);
+        const int size = q.request.agentSize;
+        const SubgoalGraph& graph = profile.Subgoals(size);
+        return ReplayResult{ FindPath(q.request.start, q.request.goal, profile.sizeClassMaps[size - 1], graph) };
+    };
+
+    auto anyAngle = [](bool lazy)
+    {
+        return [lazy](const LoggedQuery& q, ReplayState& state)
+        {
+            if (q.request.nearest >= 0) return ReplayResult{ {}, false };
+            return ReplayResult{ FindAnyAnglePath(q.request.start, q.request.goal, state.Profile(q), lazy, nullptr,
+                q.request.agentSize) };
+        };
+    };
+
+    auto smooth = [plain](const LoggedQuery& q, ReplayState& state)
+    {
+        ProfileCache& profile = state.Profile(q);
+        vector<Cell> path = FindRequestPath(plain(q), state.MapOf(q), profile);
+        return ReplayResult{ SmoothPath(path, ProfileEnterCost(profile, q.request.agentSize)) };
+    };
+
+    auto weighted = [plain](const LoggedQuery& q, ReplayState& state)
+    {
+        PathRequest request = plain(q);
+        request.weight = 1.2f;
+        return ReplayResult{ FindRequestPath(request, state.MapOf(q), state.Profile(q)) };
+    };
+
+    // Uniform-cost BFS: tiles the profile can't enter are walls & every other move costs the same, so paths are fewest steps
+    auto bfs = [](const LoggedQuery& q, ReplayState& state)
+    {
+        if (q.request.agentSize > 1 || q.request.nearest >= 0) return ReplayResult{ {}, false };
+        state.wavefront.Run(state.Passable(q), q.request.start, true, q.request.goal);
+        return ReplayResult{ state.wavefront.PathTo(q.request.goal) };
+    };
+
+    auto bounded = [](const LoggedQuery& q, ReplayState& state)
+    {
+        if (q.request.nearest >= 0) return ReplayResult{ {}, false };
+        SearchStats stats;
+        vector<Cell> path = FindBoundedPath(q.request.start, q.request.goal, state.Profile(q), q.request.manhattan,
+            state.memory, &stats, q.request.agentSize);
+        return ReplayResult{ path, true, !stats.partial, stats.partial };
+    };
+
+    return
+    {
+        { "logged", logged },
+        { "manhattan", heuristic(true) },
+        { "euclidean", heuristic(false) },
+        { "cpd", cpd },
+        { "subgoal", subgoal },
+        { "theta", anyAngle(false) },
+        { "lazy-theta", anyAngle(true) },
+        { "smooth", smooth },
+        { "weighted", weighted },
+        { "bfs", bfs },
+        { "bounded", bounded },
+    };
+}
+
+int Replay(const char* path, const vector<string>& names)
+{
+    vector<Map> maps;
+    vector<LoggedQuery> queries;
+    if (!LoadQueryLog(path, maps, queries)) return 1;
+    printf("%zu queries against %zu map versions\n", queries.size(), maps.size());
+
+    vector<PlannerConfig> configs;
+    for (const PlannerConfig& config : PlannerConfigs())
+    {
+        if (names.empty() || find(names.begin(), names.end(), config.name) != names.end())
+            configs.push_back(config);
+    }
+    if (configs.empty() || queries.empty())
+    {
+        printf("Nothing to replay\n");
+        return 1;
+    }
+
+    vector<vector<ReplayResult>> results(configs.size());
+    for (size_t c = 0; c < configs.size(); c++)
+    {
+        ReplayState state(maps);
+        vector<double> latencies;
+        latencies.reserve(queries.size());
+        results[c].reserve(queries.size());
+
+        double seconds = 0.0;
+        size_t partial = 0;
+        for (const LoggedQuery& query : queries)
+        {
+            const auto queryBegin = chrono::steady_clock::now();
+            results[c].push_back(configs[c].plan(query, state));
+            const double elapsed = chrono::duration<double>(chrono::steady_clock::now() - queryBegin).count();
+            if (!results[c].back().answered) continue;
+            seconds += elapsed;
+            latencies.push_back(elapsed * 1e6);
+            partial += results[c].back().partial;
+        }
+        if (latencies.empty())
+        {
+            printf("%-12s can't answer any of these queries\n", configs[c].name);
+            continue;
+        }
+
+        sort(latencies.begin(), latencies.end());
+        auto percentile = [&latencies](double p) { return latencies[size_t(p * (latencies.size() - 1))]; };
+        printf("%-12s %10.0f queries/s   p50 %8.1fus   p90 %8.1fus   p99 %8.1fus   max %8.1fus", configs[c].name,
+            latencies.size() / seconds, percentile(0.5), percentile(0.9), percentile(0.99), latencies.back());
+        if (latencies.size() < queries.size())
+            printf("   (answered %zu)", latencies.size());
+        if (partial > 0)
+            printf("   (%zu partial)", partial);
+        printf("\n");
+    }
+
+    // Costed with the query's own profile & heuristic, whatever the config planned with
+    ReplayState costing(maps);
+    size_t mismatches = 0;
+    for (size_t q = 0; q < queries.size(); q++)
+    {
+        const PathRequest& request = queries[q].request;
+        auto cost = [&](const vector<Cell>& path)
+        {
+            return PathCost(path, ProfileEnterCost(costing.Profile(queries[q]), 1), request.manhattan);
+        };
+
+        size_t reference = configs.size();
+        float referenceCost = 0.0f;
+        for (size_t c = 0; c < configs.size(); c++)
+        {
+            const ReplayResult& result = results[c][q];
+            if (!result.answered || !result.exact) continue;
+            if (reference == configs.size())
+            {
+                reference = c;
+                referenceCost = cost(result.path);
+                continue;
+            }
+
+            const vector<Cell>& a = results[reference][q].path;
+            const vector<Cell>& b = result.path;
+            const float bCost = cost(b);
+            if (a.empty() == b.empty() && fabs(bCost - referenceCost) <= 1e-3f * max(1.0f, referenceCost)) continue;
+
+            if (mismatches++ < 20)
+            {
+                printf("Query %zu (%i,%i -> %i,%i): %s gave %zu tiles costing %.2f, %s gave %zu costing %.2f\n", q,
+                    request.start.col, request.start.row, request.goal.col, request.goal.row, configs[reference].name,
+                    a.size(), referenceCost, configs[c].name, b.size(), bCost);
+            }
+        }
+    }
+    printf("%zu differing results\n", mismatches);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <vector>
+#include <string>
+
+using namespace std;
+
+// Runs every logged query through each config as fast as possible & reports throughput & latency percentiles. Then,
+// among the configs meant to find optimal paths for a query, lists those whose path cost differs from the first's:
+// equally cheap paths can take different tiles. Returns nonzero if any differ, or the log can't be replayed.
+int Replay(const char* path, const vector<string>& names);
@@ -0,0 +1,31 @@
+#include "Search.h"
+
+vector<Cell> FindPath(Cell start, Cell end, const Map& map, bool manhattan, SearchStats* stats, SearchTrace* trace,
+    const ClearanceMap* clearance, int agentSize, float weight)
+{
+    auto tileCost = [&map](Cell cell) { return Cost((TileType)map[cell.row][cell.col]); };
+    return SearchGrid(start, SingleGoal{ end, 0.0f, manhattan }, tileCost, manhattan, stats, trace, clearance, agentSize, weight);
+}
+
+vector<Cell> FindAnyAnglePath(Cell start, Cell end, const Map& map, bool lazy, SearchStats* stats)
+{
+    auto tileCost = [&map](Cell cell) { return Cost((TileType)map[cell.row][cell.col]); };
+    return SearchAnyAngle(start, end, tileCost, 0.0f, lazy, stats, nullptr, 1, 1.0f);
+}
+
+vector<Cell> CompressPath(const vector<Cell>& path)
+{
+    if (path.size() < 3) return path;
+
+    vector<Cell> waypoints{ path.front() };
+    for (size_t i = 1; i + 1 < path.size(); i++)
+    {
+        // Going on in the same direction: zero cross product & positive dot product of the segments either side
+        const Cell in{ path[i].col - path[i - 1].col, path[i].row - path[i - 1].row };
+        const Cell out{ path[i + 1].col - path[i].col, path[i + 1].row - path[i].row };
+        if (in.col * out.row - in.row * out.col != 0 || in.col * out.col + in.row * out.row <= 0)
+            waypoints.push_back(path[i]);
+    }
+    waypoints.push_back(path.back());
+    return waypoints;
+}
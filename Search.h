@@ -0,0 +1,394 @@
+#pragma once
+#include "Grid.h"
+#include <queue>
+#include <chrono>
+#include <type_traits>
+#define MULTI_GOAL_DIRECT 8
+
+// Goal test & heuristic for an ordinary search to one tile. minCost is the cheapest terrain there is, charged for every
+// step the heuristic knows is left.
+struct SingleGoal
+{
+    bool Reached(Cell cell) const
+    {
+        return cell == end;
+    }
+
+    float Estimate(Cell cell) const
+    {
+        const float remaining = manhattan ? Manhattan(cell, end) : Euclidean(cell, end);
+        return remaining + Chebyshev(cell, end) * minCost;
+    }
+
+    Cell end;
+    float minCost;
+    bool manhattan;
+};
+
+// Goal test & heuristic for reaching whichever of several tiles is cheapest: the smallest single-goal estimate, or past
+// MULTI_GOAL_DIRECT goals a two-sweep chamfer field of the distance to the nearest one
+struct GoalSet
+{
+    GoalSet(const vector<Cell>& goals, float minCost, bool manhattan)
+        : goals(goals), minCost(minCost), manhattan(manhattan), mask(TILE_COUNT * TILE_COUNT, false)
+    {
+        for (const Cell& goal : goals)
+            mask[Index(goal)] = true;
+        if (goals.size() > MULTI_GOAL_DIRECT)
+            BuildField();
+    }
+
+    bool Reached(Cell cell) const
+    {
+        return mask[Index(cell)];
+    }
+
+    float Estimate(Cell cell) const
+    {
+        if (!field.empty())
+            return field[Index(cell)];
+
+        float best = FLT_MAX;
+        for (const Cell& goal : goals)
+            best = min(best, SingleGoal{ goal, minCost, manhattan }.Estimate(cell));
+        return best;
+    }
+
+    void BuildField()
+    {
+        const float straight = 1.0f + minCost;
+        const float diagonal = (manhattan ? 2.0f : sqrtf(2.0f)) + minCost;
+        field.assign(TILE_COUNT * TILE_COUNT, FLT_MAX);
+        for (const Cell& goal : goals)
+            field[Index(goal)] = 0.0f;
+
+        // Forward sweep pulls distances from the row above & the tile to the left, the backward sweep from below & right
+        auto relax = [&](int col, int row, int dCol, int dRow, float cost)
+        {
+            const Cell from{ col + dCol, row + dRow };
+            if (InBounds(from))
+                field[Index({ col, row })] = min(field[Index({ col, row })], field[Index(from)] + cost);
+        };
+        for (int row = 0; row < TILE_COUNT; row++)
+        {
+            for (int col = 0; col < TILE_COUNT; col++)
+            {
+                relax(col, row, -1, -1, diagonal);
+                relax(col, row, 0, -1, straight);
+                relax(col, row, 1, -1, diagonal);
+                relax(col, row, -1, 0, straight);
+            }
+        }
+        for (int row = TILE_COUNT - 1; row >= 0; row--)
+        {
+            for (int col = TILE_COUNT - 1; col >= 0; col--)
+            {
+                relax(col, row, 1, 1, diagonal);
+                relax(col, row, 0, 1, straight);
+                relax(col, row, -1, 1, diagonal);
+                relax(col, row, 1, 0, straight);
+            }
+        }
+    }
+
+    vector<Cell> goals;
+    float minCost;
+    bool manhattan;
+    vector<bool> mask;
+    vector<float> field;
+};
+
+// FindPath's A*, templated on the tile cost lookup so each movement profile gets its own instance. tileCost(cell) is
+// IMPASSABLE for tiles that can't be entered & goal is a SingleGoal or GoalSet. A weight above 1 is weighted A*.
+template<typename Goal, typename TileCost>
+vector<Cell> SearchGrid(Cell start, const Goal& goal, TileCost tileCost, bool manhattan, SearchStats* stats,
+    SearchTrace* trace, const ClearanceMap* clearance, int agentSize, float weight = 1.0f)
+{
+    const auto startTime = chrono::steady_clock::now();
+    const size_t startBytes = gBytesAllocated;
+    SearchStats counters;
+    counters.bound = weight;
+    if (trace != nullptr)
+        trace->Clear();
+
+    // 1:1 mapping of graph nodes to tile map
+    const int nodeCount = TILE_COUNT * TILE_COUNT;
+    vector<Node> tileNodes(nodeCount);
+    vector<bool> closedList(nodeCount, false);
+    priority_queue<Node, vector<Node>, decltype(&Compare)> openList(Compare);
+    tileNodes[Index(start)] = { start, start, 0.0f, 0.0f };
+
+    // An agent that doesn't fit where it starts goes nowhere, just as it never steps onto a goal it doesn't fit on
+    if (clearance == nullptr || clearance->Fits(start, agentSize))
+    {
+        openList.push(start);
+        counters.pushed++;
+        counters.peakOpen = 1;
+    }
+
+    // Loop until we've reached the goal, or explored every tile
+    Cell end = { -1, -1 };
+    while (!openList.empty())
+    {
+        const Cell currentCell = openList.top().cell;
+
+        // Stop exploring once we've found the goal
+        if (goal.Reached(currentCell))
+        {
+            end = currentCell;
+            break;
+        }
+
+        // Otherwise, add current cell to closed list and update g & h values of its neighbours
+        if (trace != nullptr)
+            trace->Record(currentCell, openList.top().g, openList.top().h, closedList[Index(currentCell)]);
+        openList.pop();
+
+        // Better copies of a cell get pushed without removing the old ones, so skip those once closed
+        if (closedList[Index(currentCell)])
+        {
+            counters.stalePops++;
+            continue;
+        }
+        closedList[Index(currentCell)] = true;
+        counters.expanded++;
+
+        const float gCurrent = tileNodes[Index(currentCell)].g;
+        float gNew, hNew;
+        for (const Cell& neighbour : Neighbours(currentCell))
+        {
+            const size_t neighbourIndex = Index(neighbour);
+
+            // Skip if already explored
+            if (closedList[neighbourIndex]) continue;
+
+            // Skip if too narrow for the agent
+            if (clearance != nullptr && !clearance->Fits(currentCell, neighbour, agentSize)) continue;
+
+            // Skip if the terrain can't be entered at all
+            const float terrain = tileCost(neighbour);
+            if (terrain == IMPASSABLE) continue;
+
+            // Calculate scores
+            const float distance = manhattan ? Manhattan(currentCell, neighbour) : Euclidean(currentCell, neighbour);
+            gNew = gCurrent + (distance + terrain);         // Cost from start to adjacent, rounded like StepCost
+            hNew = goal.Estimate(neighbour) * weight;       // Estimate from adjacent to goal
+
+            // Append if unvisited or cheaper than the way we reached it before
+            if (tileNodes[neighbourIndex].cell.col < 0 /*unexplored*/ ||
+                gNew < tileNodes[neighbourIndex].g /*better score*/)
+            {
+                openList.push({ neighbour, gNew, hNew });
+                tileNodes[neighbourIndex] = { neighbour, currentCell, gNew, hNew };
+                counters.pushed++;
+                counters.peakOpen = max(counters.peakOpen, openList.size());
+            }
+        }
+    }
+
+    // Walk back from the goal reached, if there was one
+    vector<Cell> path;
+    Cell currentCell = end;
+    while (InBounds(currentCell) && !(tileNodes[Index(currentCell)].parent == currentCell))
+    {
+        path.push_back(currentCell);
+        currentCell = tileNodes[Index(currentCell)].parent;
+    }
+    if (currentCell == start)
+        path.push_back(start);
+    else
+        path.clear();
+    reverse(path.begin(), path.end());
+
+    if (trace != nullptr)
+        trace->nodes = move(tileNodes);
+
+    if (stats != nullptr)
+    {
+        counters.bytesAllocated = gBytesAllocated - startBytes;
+        counters.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        *stats = counters;
+    }
+    return path;
+}
+
+// Agents bigger than a tile pass a clearance map & their size; tiles too narrow for them are skipped, which for large
+// agents turns mountains into walls. Returns an empty path if the goal can't be reached.
+vector<Cell> FindPath(Cell start, Cell end, const Map& map, bool manhattan, SearchStats* stats = nullptr, SearchTrace* trace = nullptr,
+    const ClearanceMap* clearance = nullptr, int agentSize = 1, float weight = 1.0f);
+
+// Theta*: a tile takes its parent's parent as its own whenever the straight line there is cheaper, so paths come out as
+// sparse waypoints. Lazy Theta* only checks that line once the tile is expanded. Otherwise works like SearchGrid.
+template<typename TileCost>
+vector<Cell> SearchAnyAngle(Cell start, Cell end, TileCost tileCost, float minCost, bool lazy, SearchStats* stats,
+    const ClearanceMap* clearance, int agentSize, float weight)
+{
+    const auto startTime = chrono::steady_clock::now();
+    const size_t startBytes = gBytesAllocated;
+    SearchStats counters;
+    counters.bound = weight;
+
+    auto stepCost = [&](Cell from, Cell to)
+    {
+        if (clearance != nullptr && !clearance->Fits(from, to, agentSize)) return IMPASSABLE;
+        const float terrain = tileCost(to);
+        return terrain == IMPASSABLE ? IMPASSABLE : Euclidean(from, to) + terrain;
+    };
+    auto enterCost = [&](Cell from, Cell to)
+    {
+        if (clearance != nullptr && !clearance->Fits(from, to, agentSize)) return IMPASSABLE;
+        return tileCost(to);
+    };
+    auto estimate = [&](Cell cell) { return (Euclidean(cell, end) + Chebyshev(cell, end) * minCost) * weight; };
+
+    const int nodeCount = TILE_COUNT * TILE_COUNT;
+    vector<Node> tileNodes(nodeCount);
+    vector<bool> closedList(nodeCount, false);
+    priority_queue<Node, vector<Node>, decltype(&Compare)> openList(Compare);
+    tileNodes[Index(start)] = { start, start, 0.0f, estimate(start) };
+    if (clearance == nullptr || clearance->Fits(start, agentSize))
+    {
+        openList.push(tileNodes[Index(start)]);
+        counters.pushed++;
+        counters.peakOpen = 1;
+    }
+
+    bool reached = false;
+    while (!openList.empty())
+    {
+        const Cell currentCell = openList.top().cell;
+        openList.pop();
+        if (closedList[Index(currentCell)])
+        {
+            counters.stalePops++;
+            continue;
+        }
+
+        // Lazy: the line to the parent was only assumed to be cheap, check it now & fall back to the best closed neighbour.
+        // If that makes the tile worse than the best open one, it goes back on the open list to wait its turn.
+        Node& current = tileNodes[Index(currentCell)];
+        const float gLine = lazy && !(current.parent == currentCell) ?
+            tileNodes[Index(current.parent)].g + LineCost(current.parent, currentCell, enterCost) : current.g;
+        if (gLine > current.g)
+        {
+            current.g = gLine;
+            for (const Cell& neighbour : Neighbours(currentCell))
+            {
+                if (!closedList[Index(neighbour)]) continue;
+                const float gNeighbour = tileNodes[Index(neighbour)].g + stepCost(neighbour, currentCell);
+                if (gNeighbour < current.g)
+                {
+                    current.g = gNeighbour;
+                    current.parent = neighbour;
+                }
+            }
+
+            if (!openList.empty() && current.F() > openList.top().g + openList.top().h)
+            {
+                openList.push(current);
+                counters.pushed++;
+                continue;
+            }
+        }
+        closedList[Index(currentCell)] = true;
+        counters.expanded++;
+
+        if (currentCell == end)
+        {
+            reached = true;
+            break;
+        }
+
+        const Cell parentCell = current.parent;
+        const float gParent = tileNodes[Index(parentCell)].g;
+        for (const Cell& neighbour : Neighbours(currentCell))
+        {
+            const size_t neighbourIndex = Index(neighbour);
+            if (closedList[neighbourIndex]) continue;
+
+            // Skip if the agent can't step there at all
+            const float step = stepCost(currentCell, neighbour);
+            if (step == IMPASSABLE) continue;
+
+            // Through the current tile, or straight from its parent if that's cheaper
+            Cell parentNew = currentCell;
+            float gNew = current.g + step;
+            if (!(parentCell == currentCell))
+            {
+                const float gLine = lazy ?
+                    gParent + Euclidean(parentCell, neighbour) + tileCost(neighbour) :
+                    gParent + LineCost(parentCell, neighbour, enterCost);
+                if (gLine <= gNew)
+                {
+                    gNew = gLine;
+                    parentNew = parentCell;
+                }
+            }
+
+            if (tileNodes[neighbourIndex].cell.col < 0 /*unexplored*/ || gNew < tileNodes[neighbourIndex].g)
+            {
+                tileNodes[neighbourIndex] = { neighbour, parentNew, gNew, estimate(neighbour) };
+                openList.push(tileNodes[neighbourIndex]);
+                counters.pushed++;
+                counters.peakOpen = max(counters.peakOpen, openList.size());
+            }
+        }
+    }
+
+    vector<Cell> path;
+    if (reached)
+    {
+        for (Cell cell = end; !(tileNodes[Index(cell)].parent == cell); cell = tileNodes[Index(cell)].parent)
+            path.push_back(cell);
+        path.push_back(start);
+        reverse(path.begin(), path.end());
+    }
+
+    if (stats != nullptr)
+    {
+        counters.bytesAllocated = gBytesAllocated - startBytes;
+        counters.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+        *stats = counters;
+    }
+    return path;
+}
+
+vector<Cell> FindAnyAnglePath(Cell start, Cell end, const Map& map, bool lazy, SearchStats* stats = nullptr);
+
+// Keeps only the tiles where a path turns, so a straight run costs two waypoints however long it is
+vector<Cell> CompressPath(const vector<Cell>& path);
+
+// String pulling: from each waypoint, jumps to the furthest later one a straight line reaches for no more than the path
+// there costs under enterCost, so the result never costs more than the path it came from
+template<typename EnterCost>
+vector<Cell> SmoothPath(const vector<Cell>& path, EnterCost enterCost)
+{
+    static_assert(is_invocable_r_v<float, EnterCost, Cell, Cell>, "SmoothPath needs an enterCost(from, to), not a map");
+    const vector<Cell> waypoints = CompressPath(path);
+    if (waypoints.size() < 3) return waypoints;
+
+    // Cost along the path up to each waypoint. A path the cost model says can't be walked is left as it is.
+    vector<float> along(waypoints.size(), 0.0f);
+    for (size_t i = 1; i < waypoints.size(); i++)
+    {
+        const float cost = LineCost(waypoints[i - 1], waypoints[i], enterCost);
+        if (cost == IMPASSABLE) return waypoints;
+        along[i] = along[i - 1] + cost;
+    }
+
+    vector<Cell> smoothed{ waypoints.front() };
+    size_t anchor = 0;
+    while (anchor + 1 < waypoints.size())
+    {
+        size_t next = anchor + 1;
+        for (size_t i = anchor + 2; i < waypoints.size(); i++)
+        {
+            const float cost = LineCost(waypoints[anchor], waypoints[i], enterCost);
+            if (cost != IMPASSABLE && cost <= along[i] - along[anchor] + 1e-4f)
+                next = i;
+        }
+        smoothed.push_back(waypoints[next]);
+        anchor = next;
+    }
+    return CompressPath(smoothed);
+}
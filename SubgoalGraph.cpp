@@ -0,0 +1,274 @@
+#include "SubgoalGraph.h"
+#include <queue>
+#include <chrono>
+
+bool Blocked(const Map& map, Cell cell)
+{
+    return cell.col < 0 || cell.col >= TILE_COUNT || cell.row < 0 || cell.row >= TILE_COUNT ||
+        map[cell.row][cell.col] == MOUNTAIN;
+}
+
+bool CanStep(const Map& map, Cell from, Cell direction)
+{
+    const Cell to{ from.col + direction.col, from.row + direction.row };
+    if (Blocked(map, to)) return false;
+    if (direction.col != 0 && direction.row != 0)
+        return !Blocked(map, { to.col, from.row }) && !Blocked(map, { from.col, to.row });
+    return true;
+}
+
+float Octile(Cell a, Cell b)
+{
+    const int dx = abs(b.col - a.col);
+    const int dy = abs(b.row - a.row);
+    return max(dx, dy) + (sqrtf(2.0f) - 1.0f) * min(dx, dy);
+}
+
+// Steps we can take from cell in direction before running into an obstacle or a subgoal
+int Clearance(const Map& map, const SubgoalGraph& graph, Cell cell, Cell direction, bool& hitSubgoal)
+{
+    int steps = 0;
+    hitSubgoal = false;
+    while (CanStep(map, cell, direction))
+    {
+        cell = { cell.col + direction.col, cell.row + direction.row };
+        if (graph.ids[Index(cell)] >= 0)
+        {
+            hitSubgoal = true;
+            break;
+        }
+        steps++;
+    }
+    return steps;
+}
+
+// Subgoals reachable from cell by an octile-length path that doesn't pass through another subgoal
+vector<int> DirectHReachable(const Map& map, const SubgoalGraph& graph, Cell cell)
+{
+    vector<int> reachable;
+    auto add = [&](Cell subgoal)
+    {
+        const int id = graph.ids[Index(subgoal)];
+        if (find(reachable.begin(), reachable.end(), id) == reachable.end())
+            reachable.push_back(id);
+    };
+
+    bool hit;
+    for (const Cell& direction : MOVES)
+    {
+        const int steps = Clearance(map, graph, cell, direction, hit);
+        if (hit) add({ cell.col + (steps + 1) * direction.col, cell.row + (steps + 1) * direction.row });
+    }
+
+    for (const Cell& diagonal : MOVES)
+    {
+        if (diagonal.col == 0 || diagonal.row == 0) continue;
+
+        const array<Cell, 2> cardinals{ Cell{ diagonal.col, 0 }, Cell{ 0, diagonal.row } };
+        array<int, 2> maxSteps{ Clearance(map, graph, cell, cardinals[0], hit), Clearance(map, graph, cell, cardinals[1], hit) };
+        const int diagonalSteps = Clearance(map, graph, cell, diagonal, hit);
+
+        for (int i = 1; i <= diagonalSteps; i++)
+        {
+            const Cell corner{ cell.col + i * diagonal.col, cell.row + i * diagonal.row };
+            for (int c = 0; c < 2; c++)
+            {
+                int steps = Clearance(map, graph, corner, cardinals[c], hit);
+                if (steps <= maxSteps[c] && hit)
+                {
+                    add({ corner.col + (steps + 1) * cardinals[c].col, corner.row + (steps + 1) * cardinals[c].row });
+                    steps--;
+                }
+                maxSteps[c] = min(maxSteps[c], steps);
+            }
+        }
+    }
+    return reachable;
+}
+
+// Octile-length path from a to b (diagonal moves & moves along the longer axis only), empty if there isn't one
+vector<Cell> HReachablePath(const Map& map, Cell a, Cell b)
+{
+    const int dx = b.col - a.col, dy = b.row - a.row;
+    const Cell diagonal{ (dx > 0) - (dx < 0), (dy > 0) - (dy < 0) };
+    const Cell straight = abs(dx) >= abs(dy) ? Cell{ diagonal.col, 0 } : Cell{ 0, diagonal.row };
+    const int diagonals = min(abs(dx), abs(dy));
+    const int straights = max(abs(dx), abs(dy)) - diagonals;
+
+    // reached[i][j]: a + i diagonals + j straights is reachable using only those moves
+    const int width = straights + 1;
+    vector<bool> reached((diagonals + 1) * width, false);
+    reached[0] = !Blocked(map, a);
+    for (int i = 0; i <= diagonals; i++)
+    {
+        for (int j = 0; j <= straights; j++)
+        {
+            if (i == 0 && j == 0) continue;
+            const Cell cell{ a.col + i * diagonal.col + j * straight.col, a.row + i * diagonal.row + j * straight.row };
+            const Cell fromDiagonal{ cell.col - diagonal.col, cell.row - diagonal.row };
+            const Cell fromStraight{ cell.col - straight.col, cell.row - straight.row };
+            reached[i * width + j] =
+                (i > 0 && reached[(i - 1) * width + j] && CanStep(map, fromDiagonal, diagonal)) ||
+                (j > 0 && reached[i * width + j - 1] && CanStep(map, fromStraight, straight));
+        }
+    }
+    if (!reached.back()) return {};
+
+    // Walk back from b, preferring diagonals
+    vector<Cell> path{ b };
+    int i = diagonals, j = straights;
+    while (i > 0 || j > 0)
+    {
+        const Cell cell = path.back();
+        if (i > 0 && reached[(i - 1) * width + j] && CanStep(map, { cell.col - diagonal.col, cell.row - diagonal.row }, diagonal))
+        {
+            i--;
+            path.push_back({ cell.col - diagonal.col, cell.row - diagonal.row });
+        }
+        else
+        {
+            j--;
+            path.push_back({ cell.col - straight.col, cell.row - straight.row });
+        }
+    }
+    reverse(path.begin(), path.end());
+    return path;
+}
+
+SubgoalGraph BuildSubgoalGraph(const Map& map, uint64_t mapVersion)
+{
+    SubgoalGraph graph;
+    graph.mapVersion = mapVersion;
+    graph.ids.assign(TILE_COUNT * TILE_COUNT, -1);
+
+    for (int row = 0; row < TILE_COUNT; row++)
+    {
+        for (int col = 0; col < TILE_COUNT; col++)
+        {
+            const Cell cell{ col, row };
+            if (Blocked(map, cell)) continue;
+
+            for (const Cell& diagonal : MOVES)
+            {
+                if (diagonal.col == 0 || diagonal.row == 0) continue;
+                if (Blocked(map, { col + diagonal.col, row + diagonal.row }) &&
+                    !Blocked(map, { col + diagonal.col, row }) && !Blocked(map, { col, row + diagonal.row }))
+                {
+                    graph.ids[Index(cell)] = (int)graph.subgoals.size();
+                    graph.subgoals.push_back(cell);
+                    break;
+                }
+            }
+        }
+    }
+
+    graph.edges.resize(graph.subgoals.size());
+    for (size_t id = 0; id < graph.subgoals.size(); id++)
+    {
+        for (int other : DirectHReachable(map, graph, graph.subgoals[id]))
+            graph.edges[id].push_back({ other, Octile(graph.subgoals[id], graph.subgoals[other]) });
+    }
+    return graph;
+}
+
+vector<Cell> FindPath(Cell start, Cell end, const Map& map, const SubgoalGraph& graph, SearchStats* stats)
+{
+    const auto startTime = chrono::steady_clock::now();
+    const size_t startBytes = gBytesAllocated;
+    SearchStats counters;
+
+    auto finish = [&](vector<Cell> path)
+    {
+        if (stats != nullptr)
+        {
+            counters.bytesAllocated = gBytesAllocated - startBytes;
+            counters.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+            *stats = counters;
+        }
+        return path;
+    };
+
+    if (Blocked(map, start) || Blocked(map, end))
+        return finish({});
+
+    vector<Cell> direct = HReachablePath(map, start, end);
+    if (!direct.empty())
+        return finish(direct);
+
+    // Subgoals are ids [0, n), start & goal get n and n + 1 unless they're subgoals already
+    const int subgoalCount = (int)graph.subgoals.size();
+    const int startId = graph.ids[Index(start)] >= 0 ? graph.ids[Index(start)] : subgoalCount;
+    const int goalId = graph.ids[Index(end)] >= 0 ? graph.ids[Index(end)] : subgoalCount + 1;
+    auto cellOf = [&](int id) { return id < subgoalCount ? graph.subgoals[id] : (id == startId ? start : end); };
+
+    vector<float> goalEdges(subgoalCount, -1.0f);
+    if (goalId == subgoalCount + 1)
+    {
+        for (int id : DirectHReachable(map, graph, end))
+            goalEdges[id] = Octile(graph.subgoals[id], end);
+    }
+    vector<int> startEdges;
+    if (startId == subgoalCount)
+        startEdges = DirectHReachable(map, graph, start);
+
+    vector<float> g(subgoalCount + 2, FLT_MAX);
+    vector<int> parents(subgoalCount + 2, -1);
+    vector<bool> closedList(subgoalCount + 2, false);
+    using Entry = pair<float, int>;
+    priority_queue<Entry, vector<Entry>, greater<Entry>> openList;
+    g[startId] = 0.0f;
+    openList.push({ Octile(start, end), startId });
+    counters.pushed++;
+
+    auto relax = [&](int from, int to, float cost)
+    {
+        if (closedList[to] || g[from] + cost >= g[to]) return;
+        g[to] = g[from] + cost;
+        parents[to] = from;
+        openList.push({ g[to] + Octile(cellOf(to), end), to });
+        counters.pushed++;
+        counters.peakOpen = max(counters.peakOpen, openList.size());
+    };
+
+    while (!openList.empty())
+    {
+        const int current = openList.top().second;
+        openList.pop();
+        if (closedList[current])
+        {
+            counters.stalePops++;
+            continue;
+        }
+        closedList[current] = true;
+        counters.expanded++;
+        if (current == goalId) break;
+
+        if (current == startId && startId == subgoalCount)
+        {
+            for (int id : startEdges)
+                relax(current, id, Octile(start, graph.subgoals[id]));
+            continue;
+        }
+
+        for (const pair<int, float>& edge : graph.edges[current])
+            relax(current, edge.first, edge.second);
+        if (goalEdges[current] >= 0.0f)
+            relax(current, goalId, goalEdges[current]);
+    }
+
+    if (!closedList[goalId])
+        return finish({});
+
+    vector<int> hops;
+    for (int id = goalId; id != -1; id = parents[id])
+        hops.push_back(id);
+    reverse(hops.begin(), hops.end());
+
+    vector<Cell> path{ start };
+    for (size_t i = 1; i < hops.size(); i++)
+    {
+        const vector<Cell> segment = HReachablePath(map, cellOf(hops[i - 1]), cellOf(hops[i]));
+        path.insert(path.end(), segment.begin() + 1, segment.end());
+    }
+    return finish(path);
+}
@@ -0,0 +1,90 @@
+#include "Wavefront.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+void SpreadRow(const uint64_t* in, uint64_t* out, int stride)
+{
+#if defined(__AVX2__)
+    // Lanes shift by one bit, then take the bit that crossed in from the neighbouring word (the lane or vector beside)
+    __m256i previous = _mm256_setzero_si256();
+    for (int w = 0; w < stride; w += 4)
+    {
+        const __m256i x = _mm256_loadu_si256((const __m256i*)(in + w));
+        const __m256i next = w + 4 < stride ? _mm256_loadu_si256((const __m256i*)(in + w + 4)) : _mm256_setzero_si256();
+        const __m256i lower = _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 3)),
+            _mm256_permute4x64_epi64(previous, _MM_SHUFFLE(3, 3, 3, 3)), 0x03);
+        const __m256i higher = _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(0, 3, 2, 1)),
+            _mm256_permute4x64_epi64(next, _MM_SHUFFLE(0, 0, 0, 0)), 0xC0);
+        __m256i spread = _mm256_or_si256(x, _mm256_slli_epi64(x, 1));
+        spread = _mm256_or_si256(spread, _mm256_srli_epi64(x, 1));
+        spread = _mm256_or_si256(spread, _mm256_srli_epi64(lower, 63));
+        spread = _mm256_or_si256(spread, _mm256_slli_epi64(higher, 63));
+        _mm256_storeu_si256((__m256i*)(out + w), spread);
+        previous = x;
+    }
+#else
+    for (int w = 0; w < stride; w++)
+    {
+        const uint64_t x = in[w];
+        const uint64_t fromLeft = w > 0 ? in[w - 1] >> 63 : 0;
+        const uint64_t fromRight = w + 1 < stride ? in[w + 1] << 63 : 0;
+        out[w] = x | (x << 1) | (x >> 1) | fromLeft | fromRight;
+    }
+#endif
+}
+
+bool AdvanceRow(const uint64_t* above, const uint64_t* middle, const uint64_t* below, const uint64_t* passable,
+    uint64_t* visited, uint64_t* out, int stride)
+{
+#if defined(__AVX2__)
+    __m256i any = _mm256_setzero_si256();
+    for (int w = 0; w < stride; w += 4)
+    {
+        __m256i reached = _mm256_or_si256(_mm256_loadu_si256((const __m256i*)(above + w)), _mm256_loadu_si256((const __m256i*)(middle + w)));
+        reached = _mm256_or_si256(reached, _mm256_loadu_si256((const __m256i*)(below + w)));
+        reached = _mm256_and_si256(reached, _mm256_loadu_si256((const __m256i*)(passable + w)));
+        const __m256i seen = _mm256_loadu_si256((const __m256i*)(visited + w));
+        reached = _mm256_andnot_si256(seen, reached);
+        _mm256_storeu_si256((__m256i*)(out + w), reached);
+        _mm256_storeu_si256((__m256i*)(visited + w), _mm256_or_si256(seen, reached));
+        any = _mm256_or_si256(any, reached);
+    }
+    return !_mm256_testz_si256(any, any);
+#else
+    uint64_t any = 0;
+    for (int w = 0; w < stride; w++)
+    {
+        const uint64_t reached = (above[w] | middle[w] | below[w]) & passable[w] & ~visited[w];
+        out[w] = reached;
+        visited[w] |= reached;
+        any |= reached;
+    }
+    return any != 0;
+#endif
+}
+
+void QueueBfs(const TileGrid& grid, Cell start, Cell goal, vector<uint32_t>& distances)
+{
+    distances.assign(grid.tiles.size(), UINT32_MAX);
+    if (grid.tiles[grid.Index(start)] == MOUNTAIN) return;
+
+    const size_t goalIndex = grid.InBounds(goal) ? grid.Index(goal) : SIZE_MAX;
+    vector<uint32_t> queue{ uint32_t(grid.Index(start)) };
+    distances[grid.Index(start)] = 0;
+    if (grid.Index(start) == goalIndex) return;
+    for (size_t head = 0; head < queue.size(); head++)
+    {
+        const Cell cell = grid.CellOf(queue[head]);
+        for (const Cell& move : MOVES)
+        {
+            const Cell neighbour{ cell.col + move.col, cell.row + move.row };
+            if (!grid.InBounds(neighbour)) continue;
+            const size_t index = grid.Index(neighbour);
+            if (distances[index] != UINT32_MAX || grid.tiles[index] == MOUNTAIN) continue;
+            distances[index] = distances[queue[head]] + 1;
+            if (index == goalIndex) return;
+            queue.push_back(uint32_t(index));
+        }
+    }
+}
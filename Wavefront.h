@@ -0,0 +1,221 @@
+#pragma once
+#include "Grid.h"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Tiles packed 64 to a word, each row padded out to whole 256-bit vectors. The map's size unless given another.
+struct TileBits
+{
+    TileBits() : TileBits(TILE_COUNT, TILE_COUNT) {}
+
+    TileBits(int width, int height)
+        : width(width), height(height), stride((width + 255) / 256 * 4), words(size_t(height) * stride, 0)
+    {
+    }
+
+    bool Test(Cell cell) const
+    {
+        return (Row(cell.row)[cell.col / 64] >> (cell.col % 64)) & 1;
+    }
+
+    void Set(Cell cell)
+    {
+        Row(cell.row)[cell.col / 64] |= uint64_t(1) << (cell.col % 64);
+    }
+
+    uint64_t* Row(int row)
+    {
+        return words.data() + size_t(row) * stride;
+    }
+
+    const uint64_t* Row(int row) const
+    {
+        return words.data() + size_t(row) * stride;
+    }
+
+    int width;
+    int height;
+    int stride;             // Words per row
+    vector<uint64_t> words;
+};
+
+// Bit-packed layer of the tiles passable(cell) accepts
+template<typename Passable>
+TileBits PackTiles(Passable passable)
+{
+    TileBits bits;
+    for (int row = 0; row < TILE_COUNT; row++)
+    {
+        for (int col = 0; col < TILE_COUNT; col++)
+        {
+            if (passable(Cell{ col, row }))
+                bits.Set({ col, row });
+        }
+    }
+    return bits;
+}
+
+// Position of the lowest set bit, which must exist
+inline int LowestBit(uint64_t bits)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return int(index);
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+// A row of stride words with every tile also spread one tile left & right
+void SpreadRow(const uint64_t* in, uint64_t* out, int stride);
+
+// out = (above | middle | below) & passable & ~visited, marked visited. Returns whether anything was added.
+bool AdvanceRow(const uint64_t* above, const uint64_t* middle, const uint64_t* below, const uint64_t* passable,
+    uint64_t* visited, uint64_t* out, int stride);
+
+// Bit-parallel breadth-first search for maps where every move costs the same. Each layer of the wavefront is the last
+// one dilated a tile in every direction, a whole row of 64-tile words at a time, masked by passable & not yet visited.
+// Only the rows the wavefront spans are touched, & tiles are only visited one at a time to hand them to the caller.
+// Works on layers of any size; tile indices are row * width + col.
+struct Wavefront
+{
+    // Forgets what's been visited. Until then, further Expand calls only flood tiles earlier ones didn't reach.
+    void Reset()
+    {
+        fill(visited.words.begin(), visited.words.end(), 0);
+    }
+
+    // Floods from start, calling visit(index, layer) for each tile as it's reached (start being layer 0) until visit
+    // returns false or there's nothing left to reach. Returns the number of layers.
+    template<typename Visit>
+    uint32_t Expand(const TileBits& passable, Cell start, bool diagonals, Visit visit)
+    {
+        const int width = passable.width;
+        const int height = passable.height;
+        const int stride = passable.stride;
+        if (visited.width != width || visited.height != height)
+        {
+            visited = frontier = next = spread = TileBits(width, height);
+            zeros.assign(stride, 0);
+        }
+
+        if (!passable.Test(start) || visited.Test(start)) return 0;
+        frontier.Set(start);
+        visited.Set(start);
+        int top = start.row;
+        int bottom = start.row;
+        uint32_t layer = 0;
+        bool searching = visit(size_t(start.row) * width + start.col, layer);
+        while (searching)
+        {
+            // Tiles reached diagonally are those spread sideways in the rows above & below
+            for (int row = top; row <= bottom; row++)
+                SpreadRow(frontier.Row(row), spread.Row(row), stride);
+
+            int newTop = height;
+            int newBottom = -1;
+            for (int row = max(0, top - 1); row <= min(height - 1, bottom + 1); row++)
+            {
+                const TileBits& vertical = diagonals ? spread : frontier;
+                const uint64_t* above = row - 1 >= top ? vertical.Row(row - 1) : zeros.data();
+                const uint64_t* middle = row >= top && row <= bottom ? spread.Row(row) : zeros.data();
+                const uint64_t* below = row + 1 <= bottom ? vertical.Row(row + 1) : zeros.data();
+                if (AdvanceRow(above, middle, below, passable.Row(row), visited.Row(row), next.Row(row), stride))
+                {
+                    newTop = min(newTop, row);
+                    newBottom = max(newBottom, row);
+                }
+            }
+
+            // The old frontier's rows become the (zeroed) scratch for the next layer
+            for (int row = top; row <= bottom; row++)
+                fill(frontier.Row(row), frontier.Row(row) + stride, 0);
+            swap(frontier, next);
+            if (newBottom < 0) break;
+
+            top = newTop;
+            bottom = newBottom;
+            layer++;
+            for (int row = top; row <= bottom && searching; row++)
+            {
+                const uint64_t* words = frontier.Row(row);
+                for (int w = 0; w < stride && searching; w++)
+                {
+                    for (uint64_t bits = words[w]; bits != 0 && searching; bits &= bits - 1)
+                        searching = visit(size_t(row) * width + w * 64 + LowestBit(bits), layer);
+                }
+            }
+        }
+
+        for (int row = top; row <= bottom; row++)
+            fill(frontier.Row(row), frontier.Row(row) + stride, 0);
+        return layer + 1;
+    }
+
+    // Steps from start to every tile (UINT32_MAX where unreached), stopping early once goal is reached if it's in bounds
+    void Run(const TileBits& passable, Cell start, bool diagonals, Cell goal = { -1, -1 })
+    {
+        Reset();
+        this->diagonals = diagonals;
+        width = passable.width;
+        height = passable.height;
+        distances.assign(size_t(width) * height, UINT32_MAX);
+        const size_t goalIndex = Contains(goal) ? size_t(goal.row) * width + goal.col : SIZE_MAX;
+        layers = Expand(passable, start, diagonals, [&](size_t index, uint32_t layer)
+        {
+            distances[index] = layer;
+            return index != goalIndex;
+        });
+    }
+
+    bool Contains(Cell cell) const
+    {
+        return cell.col >= 0 && cell.col < width && cell.row >= 0 && cell.row < height;
+    }
+
+    uint32_t Distance(Cell cell) const
+    {
+        return distances[size_t(cell.row) * width + cell.col];
+    }
+
+    // Shortest path from the last Run's start, stepping back a layer at a time. Empty if goal wasn't reached.
+    vector<Cell> PathTo(Cell goal) const
+    {
+        if (Distance(goal) == UINT32_MAX) return {};
+
+        vector<Cell> path{ goal };
+        for (Cell current = goal; Distance(current) > 0; )
+        {
+            for (const Cell& move : MOVES)
+            {
+                const Cell neighbour{ current.col + move.col, current.row + move.row };
+                if (!Contains(neighbour) || (!diagonals && move.col != 0 && move.row != 0)) continue;
+                if (Distance(neighbour) == Distance(current) - 1)
+                {
+                    current = neighbour;
+                    break;
+                }
+            }
+            path.push_back(current);
+        }
+        reverse(path.begin(), path.end());
+        return path;
+    }
+
+    TileBits visited;
+    TileBits frontier;
+    TileBits next;
+    TileBits spread;
+    vector<uint64_t> zeros = vector<uint64_t>(TileBits().stride, 0);
+    bool diagonals = true;
+    int width = TILE_COUNT;     // Of the last Run
+    int height = TILE_COUNT;
+    vector<uint32_t> distances;
+    uint32_t layers = 0;
+};
+
+// Node-by-node BFS over the grid's tiles that aren't mountain, 8-way like Wavefront, stopping once goal is reached if
+// it's on the grid. The baseline the wavefront is measured against. Distances are in steps, UINT32_MAX where unreached.
+void QueueBfs(const TileGrid& grid, Cell start, Cell goal, vector<uint32_t>& distances);
@@ -0,0 +1,106 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+using namespace std;
+
+// Threads kept around to split per-tick work between, since starting new ones every tick would eat most of the budget.
+// The calling thread takes chunks too, so a pool without helpers just runs everything inline.
+struct WorkerPool
+{
+    void Start(unsigned int helpers)
+    {
+        running = true;
+        for (unsigned int i = 0; i < helpers; i++)
+            helperThreads.emplace_back(&WorkerPool::Help, this);
+    }
+
+    void Stop()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            running = false;
+        }
+        wake.notify_all();
+        for (thread& helper : helperThreads)
+            helper.join();
+        helperThreads.clear();
+    }
+
+    // Runs body over [0, count) in chunks of grain items & returns once all of them are done
+    void ParallelFor(size_t count, size_t grain, const function<void(size_t, size_t)>& body)
+    {
+        const size_t chunks = (count + grain - 1) / grain;
+        if (helperThreads.empty() || chunks <= 1)
+        {
+            if (count > 0) body(0, count);
+            return;
+        }
+
+        {
+            // Helpers only read the job while active, so it's safe to replace once they've all finished the last one
+            unique_lock<mutex> guard(lock);
+            idle.wait(guard, [this]() { return active == 0; });
+            job = &body;
+            jobCount = count;
+            jobGrain = grain;
+            jobChunks = chunks;
+            nextChunk = 0;
+            generation++;
+        }
+        wake.notify_all();
+        RunChunks();
+
+        unique_lock<mutex> guard(lock);
+        idle.wait(guard, [this]() { return active == 0; });
+    }
+
+    void RunChunks()
+    {
+        for (size_t chunk = nextChunk++; chunk < jobChunks; chunk = nextChunk++)
+        {
+            const size_t begin = chunk * jobGrain;
+            (*job)(begin, min(begin + jobGrain, jobCount));
+        }
+    }
+
+    void Help()
+    {
+        uint64_t seen = 0;
+        unique_lock<mutex> guard(lock);
+        while (true)
+        {
+            wake.wait(guard, [&]() { return !running || generation != seen; });
+            if (!running) return;
+            seen = generation;
+            active++;
+
+            guard.unlock();
+            RunChunks();
+            guard.lock();
+
+            if (--active == 0)
+                idle.notify_all();
+        }
+    }
+
+    vector<thread> helperThreads;
+    mutex lock;
+    condition_variable wake;
+    condition_variable idle;
+    bool running = false;
+    uint64_t generation = 0;
+    size_t active = 0;
+
+    const function<void(size_t, size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    size_t jobGrain = 1;
+    size_t jobChunks = 0;
+    atomic<size_t> nextChunk{ 0 };
+};
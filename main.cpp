@@ -1,255 +1,2214 @@
 #include "rlImGui.h"
 #include "Math.h"
+#include "rlgl.h"
+#include "Grid.h"
+#include "Search.h"
+#include "Cpd.h"
+#include "Wavefront.h"
+#include "SubgoalGraph.h"
+#include "ProfileCache.h"
+#include "BoundedSearch.h"
+#include "DistanceField.h"
+#include "PathRepair.h"
+#include "AnytimeSearch.h"
+#include "Mapf.h"
+#include "QueryLog.h"
+#include "Replay.h"
 #include <array>
 #include <vector>
 #include <queue>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
+#include <tuple>
+#include <deque>
+#include <random>
+#include <numeric>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 #define SCREEN_WIDTH 1280
 #define SCREEN_HEIGHT 720
-#define TILE_COUNT 10
+#define HISTORY_COUNT 120
+#define LABEL_TEXTURE_MAX 4096
+#define TERRAIN_CHUNK 64
+#define SIMULATION_HZ 30
+#define CBS_TIME_LIMIT 1000.0
+#define CBS_UI_TIME_LIMIT 250.0
+#define ANYTIME_SLICE 8.0
 
 using namespace std;
 
-constexpr float TILE_WIDTH = SCREEN_WIDTH / (float)TILE_COUNT;
-constexpr float TILE_HEIGHT = SCREEN_HEIGHT / (float)TILE_COUNT;
+// Replacing the global allocator puts a counter on every allocation in the program, so only profiling builds
+// (-DPROFILE_ALLOCATIONS) feed gBytesAllocated; otherwise the count stays at zero & the profiler says so.
+#if defined(PROFILE_ALLOCATIONS)
+// Alignments malloc doesn't guarantee over-allocate & keep malloc's pointer just before the block, for FreeAligned
+void* AllocateCounted(size_t size, size_t alignment)
+{
+    gBytesAllocated += size;
+    if (size == 0) size = 1;
+    if (alignment <= alignof(max_align_t))
+        return malloc(size);
+
+    void* memory = malloc(size + alignment + sizeof(void*));
+    if (memory == nullptr) return nullptr;
+    const uintptr_t aligned = ((uintptr_t)memory + sizeof(void*) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    ((void**)aligned)[-1] = memory;
+    return (void*)aligned;
+}
+
+void* AllocateCountedOrThrow(size_t size, size_t alignment)
+{
+    if (void* memory = AllocateCounted(size, alignment))
+        return memory;
+    throw bad_alloc();
+}
+
+void FreeAligned(void* memory, size_t alignment)
+{
+    if (memory != nullptr)
+        free(alignment <= alignof(max_align_t) ? memory : ((void**)memory)[-1]);
+}
+
+void* operator new(size_t size) { return AllocateCountedOrThrow(size, 0); }
+void* operator new[](size_t size) { return AllocateCountedOrThrow(size, 0); }
+void* operator new(size_t size, const nothrow_t&) noexcept { return AllocateCounted(size, 0); }
+void* operator new[](size_t size, const nothrow_t&) noexcept { return AllocateCounted(size, 0); }
+void* operator new(size_t size, align_val_t alignment) { return AllocateCountedOrThrow(size, (size_t)alignment); }
+void* operator new[](size_t size, align_val_t alignment) { return AllocateCountedOrThrow(size, (size_t)alignment); }
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept { return AllocateCounted(size, (size_t)alignment); }
+void* operator new[](size_t size, align_val_t alignment, const nothrow_t&) noexcept { return AllocateCounted(size, (size_t)alignment); }
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+void operator delete(void* memory, const nothrow_t&) noexcept { free(memory); }
+void operator delete[](void* memory, const nothrow_t&) noexcept { free(memory); }
+void operator delete(void* memory, align_val_t alignment) noexcept { FreeAligned(memory, (size_t)alignment); }
+void operator delete[](void* memory, align_val_t alignment) noexcept { FreeAligned(memory, (size_t)alignment); }
+void operator delete(void* memory, size_t, align_val_t alignment) noexcept { FreeAligned(memory, (size_t)alignment); }
+void operator delete[](void* memory, size_t, align_val_t alignment) noexcept { FreeAligned(memory, (size_t)alignment); }
+void operator delete(void* memory, align_val_t alignment, const nothrow_t&) noexcept { FreeAligned(memory, (size_t)alignment); }
+void operator delete[](void* memory, align_val_t alignment, const nothrow_t&) noexcept { FreeAligned(memory, (size_t)alignment); }
+#endif
+
+// World-space tile size, the camera decides how big that ends up on screen (a 10x10 map fills the window at zoom 1)
+constexpr float TILE_WIDTH = SCREEN_WIDTH / 10.0f;
+constexpr float TILE_HEIGHT = SCREEN_HEIGHT / 10.0f;
+
+// From game world to graph world "Quantization"
+Cell WorldToTile(Vector2 position)
+{
+    return { (int)floorf(position.x / TILE_WIDTH), (int)floorf(position.y / TILE_HEIGHT) };
+}
+
+// From graph world to game world "Localization"
+Vector2 TileToWorld(Cell cell)
+{
+    return { cell.col * TILE_WIDTH, cell.row * TILE_HEIGHT };
+}
+
+// Same as above, but through the camera so they work with window (mouse) coordinates
+Cell ScreenToTile(Vector2 position, const Camera2D& camera)
+{
+    return WorldToTile(GetScreenToWorld2D(position, camera));
+}
+
+Vector2 TileToScreen(Cell cell, const Camera2D& camera)
+{
+    return GetWorldToScreen2D(TileToWorld(cell), camera);
+}
+
+Vector2 TileCenter(Cell cell)
+{
+    return TileToWorld(cell) + Vector2{ TILE_WIDTH * 0.5f, TILE_HEIGHT * 0.5f };
+}
+
+// Inclusive range of tiles the camera can see, clamped to the map
+struct TileRect
+{
+    bool Contains(Cell cell) const
+    {
+        return cell.col >= minCol && cell.col <= maxCol && cell.row >= minRow && cell.row <= maxRow;
+    }
+
+    int minCol, minRow, maxCol, maxRow;
+};
+
+TileRect VisibleTiles(const Camera2D& camera)
+{
+    const Cell topLeft = ScreenToTile({ 0.0f, 0.0f }, camera);
+    const Cell bottomRight = ScreenToTile({ (float)GetScreenWidth(), (float)GetScreenHeight() }, camera);
+    return { max(topLeft.col, 0), max(topLeft.row, 0), min(bottomRight.col, TILE_COUNT - 1), min(bottomRight.row, TILE_COUNT - 1) };
+}
+
+// Starts out showing the whole map
+Camera2D FitCamera()
+{
+    Camera2D camera{};
+    camera.zoom = min(SCREEN_WIDTH / (TILE_COUNT * TILE_WIDTH), SCREEN_HEIGHT / (TILE_COUNT * TILE_HEIGHT));
+    return camera;
+}
+
+// Right/middle drag pans, the mouse wheel zooms around the cursor
+void PanZoom(Camera2D& camera)
+{
+    if (ImGui::GetIO().WantCaptureMouse) return;
+
+    if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT) || IsMouseButtonDown(MOUSE_BUTTON_MIDDLE))
+        camera.target = Vector2Subtract(camera.target, Vector2Scale(GetMouseDelta(), 1.0f / camera.zoom));
+
+    const float wheel = GetMouseWheelMove();
+    if (wheel != 0.0f)
+    {
+        camera.target = GetScreenToWorld2D(GetMousePosition(), camera);
+        camera.offset = GetMousePosition();
+        camera.zoom = Clamp(camera.zoom * (1.0f + 0.1f * wheel), 0.01f, 16.0f);
+    }
+}
+
+// Rolling window of per-query values for ImGui::PlotLines
+struct History
+{
+    void Push(float value)
+    {
+        values[offset] = value;
+        offset = (offset + 1) % HISTORY_COUNT;
+        count = min(count + 1, HISTORY_COUNT);
+    }
+
+    float Average() const
+    {
+        float sum = 0.0f;
+        for (int i = 0; i < count; i++)
+            sum += values[i];
+        return count > 0 ? sum / count : 0.0f;
+    }
+
+    float Min() const
+    {
+        return count > 0 ? *min_element(values.begin(), values.begin() + count) : 0.0f;
+    }
+
+    float Percentile(float p) const
+    {
+        if (count == 0) return 0.0f;
+        array<float, HISTORY_COUNT> sorted = values;
+        sort(sorted.begin(), sorted.begin() + count);
+        return sorted[size_t(p * (count - 1))];
+    }
+
+    // i = 0 is the oldest value still in the window
+    float Get(int i) const
+    {
+        const int oldest = count < HISTORY_COUNT ? 0 : offset;
+        return values[(oldest + i) % HISTORY_COUNT];
+    }
+
+    array<float, HISTORY_COUNT> values{};
+    int offset = 0;
+    int count = 0;
+};
+
+struct SearchProfiler
+{
+    void Record(const SearchStats& stats)
+    {
+        last = stats;
+        queries++;
+        expanded.Push(stats.expanded);
+        pushed.Push(stats.pushed);
+        stalePops.Push(stats.stalePops);
+        peakOpen.Push(stats.peakOpen);
+#if defined(PROFILE_ALLOCATIONS)
+        kilobytes.Push(stats.bytesAllocated / 1024.0f);
+#endif
+        milliseconds.Push(stats.milliseconds);
+    }
+
+    SearchStats last;
+    size_t queries = 0;
+    History expanded;
+    History pushed;
+    History stalePops;
+    History peakOpen;
+#if defined(PROFILE_ALLOCATIONS)
+    History kilobytes;          // Only measured when the allocator is hooked, so there's no column for it otherwise
+#endif
+    History milliseconds;
+};
+
+void PlotHistory(const char* label, const History& history)
+{
+    // Overlay the latest value & the window average so the plot doesn't need a legend
+    const float latest = history.values[(history.offset + HISTORY_COUNT - 1) % HISTORY_COUNT];
+    const char* overlay = TextFormat("%.2f (avg %.2f)", latest, history.Average());
+    ImGui::PlotLines(label, history.values.data(), HISTORY_COUNT, history.offset, overlay, 0.0f, FLT_MAX, ImVec2(0, 40));
+}
+
+void DrawProfiler(const SearchProfiler& profiler, bool manhattan)
+{
+    ImGui::Separator();
+    ImGui::Text("Query #%zu (%s)", profiler.queries, manhattan ? "Manhattan" : "Euclidean");
+    ImGui::Text("Expanded %zu, pushed %zu, stale pops %zu, peak open %zu",
+        profiler.last.expanded, profiler.last.pushed, profiler.last.stalePops, profiler.last.peakOpen);
+#if defined(PROFILE_ALLOCATIONS)
+    ImGui::Text("%.3f ms, %zu bytes allocated", profiler.last.milliseconds, profiler.last.bytesAllocated);
+#else
+    ImGui::Text("%.3f ms (allocations are only counted with PROFILE_ALLOCATIONS)", profiler.last.milliseconds);
+#endif
+    PlotHistory("Expanded", profiler.expanded);
+    PlotHistory("Pushed", profiler.pushed);
+    PlotHistory("Stale pops", profiler.stalePops);
+    PlotHistory("Peak open", profiler.peakOpen);
+#if defined(PROFILE_ALLOCATIONS)
+    PlotHistory("KB allocated", profiler.kilobytes);
+#endif
+    PlotHistory("Time (ms)", profiler.milliseconds);
+}
+
+// Where each render frame's time goes (pathfinding & agent updates live on the simulation thread, see Snapshot).
+// Phases are exclusive: a phase started inside another pauses the outer one.
+enum FramePhase
+{
+    PHASE_SIMULATION,
+    PHASE_TERRAIN,
+    PHASE_LABELS,
+    PHASE_OVERLAYS,
+    PHASE_UI,
+    PHASE_PRESENT,
+    PHASE_OTHER,
+    PHASE_COUNT
+};
+
+const char* PHASE_NAMES[PHASE_COUNT] = { "Simulation", "Terrain", "Labels", "Overlays", "UI", "Present", "Other" };
+const ImU32 PHASE_COLORS[PHASE_COUNT] =
+{
+    IM_COL32(80, 200, 120, 255),
+    IM_COL32(127, 106, 79, 255),
+    IM_COL32(190, 33, 155, 255),
+    IM_COL32(255, 161, 0, 255),
+    IM_COL32(0, 121, 241, 255),
+    IM_COL32(130, 130, 130, 255),
+    IM_COL32(200, 200, 200, 255),
+};
+
+struct FrameProfiler
+{
+    void BeginFrame()
+    {
+        frameTimes.fill(0.0);
+        current = PHASE_OTHER;
+        last = chrono::steady_clock::now();
+    }
+
+    // Charges the time since the last switch to the current phase, returns the phase we switched away from
+    FramePhase Switch(FramePhase phase)
+    {
+        const auto now = chrono::steady_clock::now();
+        frameTimes[current] += chrono::duration<double, milli>(now - last).count();
+        last = now;
+
+        const FramePhase previous = current;
+        current = phase;
+        return previous;
+    }
+
+    void EndFrame()
+    {
+        Switch(PHASE_OTHER);
+        double total = 0.0;
+        for (int phase = 0; phase < PHASE_COUNT; phase++)
+        {
+            phases[phase].Push((float)frameTimes[phase]);
+            total += frameTimes[phase];
+        }
+        totals.Push((float)total);
+    }
+
+    bool ExportCsv(const char* path) const
+    {
+        ofstream file(path, ios::trunc);
+        if (!file.is_open()) return false;
+
+        file << "frame";
+        for (const char* name : PHASE_NAMES)
+            file << "," << name;
+        file << ",Total\n";
+        for (int i = 0; i < totals.count; i++)
+        {
+            file << i;
+            for (const History& phase : phases)
+                file << "," << phase.Get(i);
+            file << "," << totals.Get(i) << "\n";
+        }
+        return (bool)file;
+    }
+
+    array<History, PHASE_COUNT> phases;
+    History totals;
+    array<double, PHASE_COUNT> frameTimes{};
+    FramePhase current = PHASE_OTHER;
+    chrono::steady_clock::time_point last;
+};
+
+// Times its scope as the given phase
+struct ScopedPhase
+{
+    ScopedPhase(FrameProfiler& profiler, FramePhase phase) : profiler(profiler), previous(profiler.Switch(phase)) {}
+    ~ScopedPhase() { profiler.Switch(previous); }
+
+    FrameProfiler& profiler;
+    FramePhase previous;
+};
+
+// Stacked bar per frame (oldest on the left) plus min/avg/p99 of every phase
+void DrawFrameProfiler(const FrameProfiler& frames)
+{
+    ImGui::Begin("Frame time");
+
+    const ImVec2 size(HISTORY_COUNT * 3.0f, 120.0f);
+    const ImVec2 origin = ImGui::GetCursorScreenPos();
+    const float scale = size.y / max(frames.totals.Percentile(1.0f), 16.7f);
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    drawList->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), IM_COL32(30, 30, 30, 255));
+
+    // 60 FPS budget line
+    const float budget = origin.y + size.y - 16.7f * scale;
+    drawList->AddLine(ImVec2(origin.x, budget), ImVec2(origin.x + size.x, budget), IM_COL32(255, 255, 255, 120));
+
+    for (int i = 0; i < frames.totals.count; i++)
+    {
+        float bottom = origin.y + size.y;
+        const float left = origin.x + i * 3.0f;
+        for (int phase = 0; phase < PHASE_COUNT; phase++)
+        {
+            const float top = bottom - frames.phases[phase].Get(i) * scale;
+            drawList->AddRectFilled(ImVec2(left, top), ImVec2(left + 2.0f, bottom), PHASE_COLORS[phase]);
+            bottom = top;
+        }
+    }
+    ImGui::Dummy(size);
+
+    ImGui::Text("%-12s %8s %8s %8s", "ms", "min", "avg", "p99");
+    for (int phase = 0; phase < PHASE_COUNT; phase++)
+    {
+        const History& history = frames.phases[phase];
+        ImGui::TextColored(ImGui::ColorConvertU32ToFloat4(PHASE_COLORS[phase]), "%-12s %8.3f %8.3f %8.3f",
+            PHASE_NAMES[phase], history.Min(), history.Average(), history.Percentile(0.99f));
+    }
+    ImGui::Text("%-12s %8.3f %8.3f %8.3f", "Total", frames.totals.Min(), frames.totals.Average(), frames.totals.Percentile(0.99f));
+
+    if (ImGui::Button("Export CSV"))
+        frames.ExportCsv("frame_times.csv");
+    ImGui::End();
+}
+
+void DrawTile(Cell cell, Color color)
+{
+    DrawRectangle(cell.col * TILE_WIDTH, cell.row * TILE_HEIGHT, TILE_WIDTH, TILE_HEIGHT, color);
+}
+
+Color TileColor(TileType type)
+{
+    Color color = WHITE;
+    switch (type)
+    {
+    case MOUNTAIN:
+        color = DARKGRAY;
+        break;
+
+    case MUD:
+        color = BROWN;
+        break;
+
+    case WATER:
+        color = BLUE;
+        color.b = 180;
+        break;
+
+    case GRASS:
+        color = GREEN;
+        color.g = 180;
+        break;
+
+    default:
+        break;
+    }
+    return color;
+}
+
+void DrawTile(Cell cell, TileType type)
+{
+    DrawTile(cell, TileColor(type));
+}
+
+void DrawTile(Cell cell, const Map& map)
+{
+    DrawTile(cell, (TileType)map[cell.row][cell.col]);
+}
+
+// Maps the tile type stored in each texel to its colour, so the whole terrain is one quad
+const char* TERRAIN_SHADER = R"(
+#version 330
+in vec2 fragTexCoord;
+in vec4 fragColor;
+uniform sampler2D texture0;
+uniform vec4 palette[5];
+out vec4 finalColor;
+
+void main()
+{
+    int type = int(texture(texture0, fragTexCoord).r * 255.0 + 0.5);
+    finalColor = palette[clamp(type, 0, 4)] * fragColor;
+}
+)";
+
+// Terrain as a tile-index texture (one byte per tile) drawn with a palette shader as a single quad.
+// Edits mark their TERRAIN_CHUNK x TERRAIN_CHUNK chunk dirty and only those chunks get re-uploaded; no draw calls involved.
+struct TerrainCache
+{
+    void Load()
+    {
+        Image image{};
+        image.data = MemAlloc(TILE_COUNT * TILE_COUNT);
+        image.width = TILE_COUNT;
+        image.height = TILE_COUNT;
+        image.mipmaps = 1;
+        image.format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE;
+        texture = LoadTextureFromImage(image);
+        UnloadImage(image);
+        SetTextureFilter(texture, TEXTURE_FILTER_POINT);
+
+        shader = LoadShaderFromMemory(nullptr, TERRAIN_SHADER);
+        array<Vector4, COUNT> palette;
+        for (size_t type = 0; type < COUNT; type++)
+            palette[type] = ColorNormalize(TileColor((TileType)type));
+        SetShaderValueV(shader, GetShaderLocation(shader, "palette"), palette.data(), SHADER_UNIFORM_VEC4, COUNT);
+
+        dirtyChunks.assign(CHUNKS * CHUNKS, true);
+    }
+
+    void Unload()
+    {
+        UnloadShader(shader);
+        UnloadTexture(texture);
+    }
+
+    void MarkDirty(Cell cell)
+    {
+        dirtyChunks[(cell.row / TERRAIN_CHUNK) * CHUNKS + cell.col / TERRAIN_CHUNK] = true;
+    }
+
+    void MarkAllDirty()
+    {
+        fill(dirtyChunks.begin(), dirtyChunks.end(), true);
+    }
+
+    void Update(const Map& map)
+    {
+        for (int chunk = 0; chunk < CHUNKS * CHUNKS; chunk++)
+        {
+            if (!dirtyChunks[chunk]) continue;
+            dirtyChunks[chunk] = false;
+
+            const int minCol = (chunk % CHUNKS) * TERRAIN_CHUNK;
+            const int minRow = (chunk / CHUNKS) * TERRAIN_CHUNK;
+            const int width = min(TERRAIN_CHUNK, TILE_COUNT - minCol);
+            const int height = min(TERRAIN_CHUNK, TILE_COUNT - minRow);
+            for (int row = 0; row < height; row++)
+                for (int col = 0; col < width; col++)
+                    pixels[row * width + col] = (uint8_t)map[minRow + row][minCol + col];
+
+            UpdateTextureRec(texture, { (float)minCol, (float)minRow, (float)width, (float)height }, pixels.data());
+        }
+    }
+
+    void Draw() const
+    {
+        const Rectangle source{ 0.0f, 0.0f, (float)TILE_COUNT, (float)TILE_COUNT };
+        const Rectangle destination{ 0.0f, 0.0f, TILE_COUNT * TILE_WIDTH, TILE_COUNT * TILE_HEIGHT };
+        BeginShaderMode(shader);
+        DrawTexturePro(texture, source, destination, { 0.0f, 0.0f }, 0.0f, WHITE);
+        EndShaderMode();
+    }
+
+    static constexpr int CHUNKS = (TILE_COUNT + TERRAIN_CHUNK - 1) / TERRAIN_CHUNK;
+
+    Texture2D texture{};
+    Shader shader{};
+    vector<bool> dirtyChunks;
+    array<uint8_t, TERRAIN_CHUNK * TERRAIN_CHUNK> pixels{};
+};
+
+// Overlay tiles in one rlgl quad batch rather than a DrawRectangle call each
+void DrawTiles(const vector<Cell>& cells, Color color, TileRect visible)
+{
+    constexpr size_t BATCH_QUADS = 1024;
+    for (size_t first = 0; first < cells.size(); first += BATCH_QUADS)
+    {
+        const size_t last = min(first + BATCH_QUADS, cells.size());
+        rlCheckRenderBatchLimit(int(4 * (last - first)));
+        rlBegin(RL_QUADS);
+        rlColor4ub(color.r, color.g, color.b, color.a);
+        for (size_t i = first; i < last; i++)
+        {
+            if (!visible.Contains(cells[i])) continue;
+            const Vector2 position = TileToWorld(cells[i]);
+            rlVertex2f(position.x, position.y);
+            rlVertex2f(position.x, position.y + TILE_HEIGHT);
+            rlVertex2f(position.x + TILE_WIDTH, position.y + TILE_HEIGHT);
+            rlVertex2f(position.x + TILE_WIDTH, position.y);
+        }
+        rlEnd();
+    }
+}
+
+// Straight lines between consecutive waypoints, which is what agents actually follow
+void DrawPathLine(const vector<Cell>& path, Color color)
+{
+    for (size_t i = 1; i < path.size(); i++)
+        DrawLineEx(TileCenter(path[i - 1]), TileCenter(path[i]), 3.0f, color);
+}
+
+// Agents are kept apart as discs this big, and only considered neighbours within CROWD_NEIGHBOUR_RADIUS
+constexpr float AGENT_RADIUS = TILE_HEIGHT * 0.15f;
+constexpr float AGENT_LEASH = TILE_HEIGHT * 0.5f;
+constexpr float CROWD_NEIGHBOUR_RADIUS = AGENT_RADIUS * 3.0f;
+constexpr float CROWD_HORIZON = 1.0f;                  // Seconds ahead that collisions are avoided
+constexpr float CROWD_AVOIDANCE = TILE_HEIGHT * 0.5f;  // Strength of avoidance, in world units per second
+constexpr int CROWD_MAX_NEIGHBOURS = 10;
+
+// Agents following paths, stored as structure-of-arrays so the update loop streams through memory.
+// Agents share paths by id; an agent that reaches the end of its path starts over from the beginning.
+// Timed paths (from cooperative planning) take one time step per entry, repeat a tile to wait, and stop at the end.
+struct Agents
+{
+    size_t AddPath(vector<Cell> path, bool timed = false)
+    {
+        paths.push_back(move(path));
+        timedPaths.push_back(timed);
+        return paths.size() - 1;
+    }
+
+    void Add(size_t path, uint32_t cursor, float t, float speed)
+    {
+        const Vector2 position = TileCenter(paths[path][cursor]);
+        x.push_back(position.x);
+        y.push_back(position.y);
+        targetX.push_back(position.x);
+        targetY.push_back(position.y);
+        vx.push_back(0.0f);
+        vy.push_back(0.0f);
+        pathIds.push_back((uint32_t)path);
+        cursors.push_back(cursor);
+        progress.push_back(t);
+        speeds.push_back(speed);
+    }
+
+    void Clear()
+    {
+        x.clear();
+        y.clear();
+        targetX.clear();
+        targetY.clear();
+        vx.clear();
+        vy.clear();
+        pathIds.clear();
+        cursors.clear();
+        progress.clear();
+        speeds.clear();
+        paths.clear();
+        timedPaths.clear();
+    }
+
+    size_t Count() const
+    {
+        return x.size();
+    }
+
+    // Moves each agent's target along its path. Speeds are in tiles per second, so movement doesn't depend on the frame
+    // rate. Targets wait for agents that fell more than AGENT_LEASH behind them (say, stuck in a crowd).
+    void Update(float dt, size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; i++)
+        {
+            const vector<Cell>& path = paths[pathIds[i]];
+            const bool timed = timedPaths[pathIds[i]];
+            if (path.size() < 2) continue;
+            if (Vector2Distance({ x[i], y[i] }, { targetX[i], targetY[i] }) > AGENT_LEASH) continue;
+
+            // Diagonal segments are longer, so they take proportionally more time (unless the path is timed)
+            float t = progress[i];
+            uint32_t cursor = cursors[i];
+            float remaining = speeds[i] * dt;
+            while (remaining > 0.0f)
+            {
+                if (timed && cursor + 2 >= path.size() && t >= 1.0f) break;
+
+                const float length = timed ? 1.0f : Euclidean(path[cursor], path[cursor + 1]);
+                const float step = min(remaining, (1.0f - t) * length);
+                t += step / length;
+                remaining -= step;
+                if (t >= 1.0f)
+                {
+                    if (timed && cursor + 2 >= path.size())
+                    {
+                        t = 1.0f;
+                        break;
+                    }
+                    t = 0.0f;
+                    cursor = cursor + 2 < path.size() ? cursor + 1 : 0;
+                }
+            }
+
+            const Vector2 position = Vector2Lerp(TileCenter(path[cursor]), TileCenter(path[cursor + 1]), t);
+            targetX[i] = position.x;
+            targetY[i] = position.y;
+            cursors[i] = cursor;
+            progress[i] = t;
+        }
+    }
+
+    vector<float> x;
+    vector<float> y;
+    vector<float> targetX;      // Where the agent should be on its path
+    vector<float> targetY;
+    vector<float> vx;           // World units per second, from the last crowd steering step
+    vector<float> vy;
+    vector<uint32_t> pathIds;
+    vector<uint32_t> cursors;   // Path index of the tile the agent is leaving
+    vector<float> progress;     // 0-1 between path[cursor] and path[cursor + 1]
+    vector<float> speeds;
+
+    vector<vector<Cell>> paths;
+    vector<bool> timedPaths;
+};
+
+// Every visible agent as a small quad in one rlgl batch
+void DrawAgents(const vector<float>& x, const vector<float>& y, TileRect visible, Color color)
+{
+    const float halfWidth = TILE_WIDTH * 0.15f;
+    const float halfHeight = TILE_HEIGHT * 0.15f;
+    const Vector2 minWorld = TileToWorld({ visible.minCol, visible.minRow });
+    const Vector2 maxWorld = TileToWorld({ visible.maxCol + 1, visible.maxRow + 1 });
+
+    constexpr size_t BATCH_QUADS = 1024;
+    for (size_t first = 0; first < x.size(); first += BATCH_QUADS)
+    {
+        const size_t last = min(first + BATCH_QUADS, x.size());
+        rlCheckRenderBatchLimit(int(4 * (last - first)));
+        rlBegin(RL_QUADS);
+        rlColor4ub(color.r, color.g, color.b, color.a);
+        for (size_t i = first; i < last; i++)
+        {
+            if (x[i] < minWorld.x || x[i] > maxWorld.x || y[i] < minWorld.y || y[i] > maxWorld.y) continue;
+            rlVertex2f(x[i] - halfWidth, y[i] - halfHeight);
+            rlVertex2f(x[i] - halfWidth, y[i] + halfHeight);
+            rlVertex2f(x[i] + halfWidth, y[i] + halfHeight);
+            rlVertex2f(x[i] + halfWidth, y[i] - halfHeight);
+        }
+        rlEnd();
+    }
+}
+
+// Scatters count agents along path with a spread of speeds
+void SpawnAgents(Agents& agents, const vector<Cell>& path, int count)
+{
+    if (path.size() < 2) return;
+
+    const size_t id = agents.AddPath(path);
+    for (int i = 0; i < count; i++)
+    {
+        const uint32_t cursor = (uint32_t)GetRandomValue(0, (int)path.size() - 2);
+        agents.Add(id, cursor, GetRandomValue(0, 99) / 100.0f, GetRandomValue(50, 300) / 100.0f);
+    }
+}
+
+// Uniform grid over the world for finding nearby agents. Cells evenly divide tiles and are at least
+// CROWD_NEIGHBOUR_RADIUS across, so an agent's neighbours are always in the 3x3 cells around its own.
+// Rebuilt every tick with a counting sort, which also lays agents out in cell order. Agent state is padded by a vector's
+// worth of slots so 8-wide loads past the last agent stay in bounds.
+struct CrowdGrid
+{
+    static constexpr size_t PADDING = 8;
+    static constexpr size_t NEIGHBOUR_STRIDE = CROWD_MAX_NEIGHBOURS + PADDING;
+    static constexpr int CELLS_PER_TILE_X = max(1, int(TILE_WIDTH / CROWD_NEIGHBOUR_RADIUS));
+    static constexpr int CELLS_PER_TILE_Y = max(1, int(TILE_HEIGHT / CROWD_NEIGHBOUR_RADIUS));
+    static constexpr int COLUMNS = TILE_COUNT * CELLS_PER_TILE_X;
+    static constexpr int ROWS = TILE_COUNT * CELLS_PER_TILE_Y;
+    static constexpr float CELL_WIDTH = TILE_WIDTH / CELLS_PER_TILE_X;
+    static constexpr float CELL_HEIGHT = TILE_HEIGHT / CELLS_PER_TILE_Y;
+
+    void Build(const Agents& agents)
+    {
+        const size_t count = agents.Count();
+        cells.resize(count);
+        cellStarts.assign(COLUMNS * ROWS + 1, 0);
+        for (size_t i = 0; i < count; i++)
+        {
+            cells[i] = Column(agents.x[i]) + Row(agents.y[i]) * COLUMNS;
+            cellStarts[cells[i] + 1]++;
+        }
+        for (size_t cell = 0; cell < COLUMNS * ROWS; cell++)
+            cellStarts[cell + 1] += cellStarts[cell];
+
+        order.resize(count);
+        x.resize(count + PADDING);
+        y.resize(count + PADDING);
+        vx.resize(count + PADDING);
+        vy.resize(count + PADDING);
+        neighbours.resize(count * NEIGHBOUR_STRIDE);
+        neighbourCounts.resize(count + PADDING);
+        vector<uint32_t> cursors(cellStarts.begin(), cellStarts.end() - 1);
+        for (size_t i = 0; i < count; i++)
+        {
+            const uint32_t slot = cursors[cells[i]]++;
+            order[slot] = (uint32_t)i;
+            x[slot] = agents.x[i];
+            y[slot] = agents.y[i];
+            vx[slot] = agents.vx[i];
+            vy[slot] = agents.vy[i];
+        }
+    }
+
+    static int Column(float worldX)
+    {
+        return Clamp(int(worldX / CELL_WIDTH), 0, COLUMNS - 1);
+    }
+
+    static int Row(float worldY)
+    {
+        return Clamp(int(worldY / CELL_HEIGHT), 0, ROWS - 1);
+    }
+
+    vector<uint32_t> cellStarts;    // Agents in cell c are order[cellStarts[c]] .. order[cellStarts[c + 1] - 1]
+    vector<uint32_t> order;
+    vector<uint32_t> cells;
+    vector<float> x;                // Agent state in cell order
+    vector<float> y;
+    vector<float> vx;
+    vector<float> vy;
+    vector<uint32_t> neighbours;    // Slots near each slot, NEIGHBOUR_STRIDE apart, filled in by FindNeighbours
+    vector<uint32_t> neighbourCounts;
+};
+
+#if defined(__AVX2__)
+// For each 8-lane mask, the indices of the lanes set in it packed to the front, a byte each
+constexpr array<uint64_t, 256> PackedLanes()
+{
+    array<uint64_t, 256> table{};
+    for (int bits = 0; bits < 256; bits++)
+    {
+        int packed = 0;
+        for (int lane = 0; lane < 8; lane++)
+        {
+            if (bits & (1 << lane))
+                table[bits] |= uint64_t(lane) << (8 * packed++);
+        }
+    }
+    return table;
+}
+constexpr array<uint64_t, 256> PACKED_LANES = PackedLanes();
+#endif
+
+int BitCount(uint32_t bits)
+{
+#if defined(_MSC_VER)
+    return int(__popcnt(bits));
+#else
+    return __builtin_popcount(bits);
+#endif
+}
+
+// Lists up to CROWD_MAX_NEIGHBOURS agents within CROWD_NEIGHBOUR_RADIUS of each slot in [begin, end), in the order the
+// 3x3 cells around it are scanned. Ranges don't share any output, so they can run in parallel.
+void FindNeighbours(CrowdGrid& grid, size_t begin, size_t end)
+{
+    constexpr float radiusSq = CROWD_NEIGHBOUR_RADIUS * CROWD_NEIGHBOUR_RADIUS;
+    for (size_t slot = begin; slot < end; slot++)
+    {
+        const float px = grid.x[slot];
+        const float py = grid.y[slot];
+        const int column = grid.cells[grid.order[slot]] % CrowdGrid::COLUMNS;
+        const int row = grid.cells[grid.order[slot]] / CrowdGrid::COLUMNS;
+        uint32_t* nearby = &grid.neighbours[slot * CrowdGrid::NEIGHBOUR_STRIDE];
+        int neighbours = 0;
+        for (int r = max(row - 1, 0); r <= min(row + 1, CrowdGrid::ROWS - 1) && neighbours < CROWD_MAX_NEIGHBOURS; r++)
+        {
+            const uint32_t first = grid.cellStarts[r * CrowdGrid::COLUMNS + max(column - 1, 0)];
+            const uint32_t last = grid.cellStarts[r * CrowdGrid::COLUMNS + min(column + 1, CrowdGrid::COLUMNS - 1) + 1];
+#if defined(__AVX2__)
+            // 8 candidates at a time, those in range packed to the front of the list with a lane shuffle. The first
+            // vector is always tested (masked) so short rows, the usual case, don't branch on their length.
+            const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+            uint32_t other = first;
+            do
+            {
+                const __m256i index = _mm256_add_epi32(_mm256_set1_epi32(int(other)), lanes);
+                const __m256 dx = _mm256_sub_ps(_mm256_set1_ps(px), _mm256_loadu_ps(&grid.x[other]));
+                const __m256 dy = _mm256_sub_ps(_mm256_set1_ps(py), _mm256_loadu_ps(&grid.y[other]));
+                const __m256 distanceSq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+                const __m256i candidate = _mm256_andnot_si256(_mm256_cmpeq_epi32(index, _mm256_set1_epi32(int(slot))),
+                    _mm256_cmpgt_epi32(_mm256_set1_epi32(int(last)), index));
+                const __m256 near = _mm256_and_ps(_mm256_castsi256_ps(candidate),
+                    _mm256_cmp_ps(distanceSq, _mm256_set1_ps(radiusSq), _CMP_LE_OQ));
+                const uint32_t bits = uint32_t(_mm256_movemask_ps(near));
+                const __m256i packed = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&PACKED_LANES[bits]));
+                _mm256_storeu_si256((__m256i*)(nearby + neighbours), _mm256_permutevar8x32_epi32(index, packed));
+                neighbours += BitCount(bits);
+                other += 8;
+            } while (other < last && neighbours < CROWD_MAX_NEIGHBOURS);
+#else
+            // Gather without branching on distance, which is close to a coin flip per candidate
+            for (uint32_t other = first; other < last && neighbours < CROWD_MAX_NEIGHBOURS; other++)
+            {
+                const float dx = px - grid.x[other];
+                const float dy = py - grid.y[other];
+                nearby[neighbours] = other;
+                neighbours += int(dx * dx + dy * dy <= radiusSq) & int(other != slot);
+            }
+#endif
+        }
+        grid.neighbourCounts[slot] = uint32_t(min(neighbours, CROWD_MAX_NEIGHBOURS));
+    }
+}
+
+// Heads for the agent's target on its path, no faster than twice its path speed, with the crowd's steering added on top
+void MoveAgent(Agents& agents, const CrowdGrid& grid, size_t slot, Vector2 steer, Vector2 push, float dt)
+{
+    const uint32_t i = grid.order[slot];
+    const float px = grid.x[slot];
+    const float py = grid.y[slot];
+    const float maxSpeed = agents.speeds[i] * TILE_WIDTH * 2.0f;
+    Vector2 velocity = Vector2Scale(Vector2Subtract({ agents.targetX[i], agents.targetY[i] }, { px, py }), 1.0f / dt);
+    if (Vector2Length(velocity) > maxSpeed)
+        velocity = Vector2Scale(Vector2Normalize(velocity), maxSpeed);
+
+    velocity = Vector2Add(velocity, steer);
+    if (Vector2Length(velocity) > maxSpeed)
+        velocity = Vector2Scale(Vector2Normalize(velocity), maxSpeed);
+    agents.vx[i] = velocity.x;
+    agents.vy[i] = velocity.y;
+    agents.x[i] = Clamp(px + velocity.x * dt + push.x, 0.0f, TILE_COUNT * TILE_WIDTH);
+    agents.y[i] = Clamp(py + velocity.y * dt + push.y, 0.0f, TILE_COUNT * TILE_HEIGHT);
+}
+
+// Moves agents towards their targets on their paths without running into each other. Overlapping agents push apart, and
+// each agent steers away from every neighbour it would touch within CROWD_HORIZON seconds at their last velocities,
+// harder the sooner, taking half the correction as the other takes the rest. That's only the reciprocal part of RVO:
+// there's no velocity obstacle solve, so dodging one neighbour can still steer into another. Reads the grid & writes
+// the agents, so ranges can run in parallel.
+void SteerAgents(Agents& agents, const CrowdGrid& grid, float dt, size_t begin, size_t end)
+{
+    constexpr float minDistance = AGENT_RADIUS * 2.0f;
+#if defined(__AVX2__)
+    // 8 agents at a time, a lane each, taking their k-th neighbours together. Every lane's sums build up independently,
+    // which keeps the square roots & divisions of one agent from stalling the next.
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 minDistanceSq = _mm256_set1_ps(minDistance * minDistance);
+    for (size_t block = begin; block < end; block += 8)
+    {
+        const __m256i self = _mm256_add_epi32(_mm256_set1_epi32(int(block)), lanes);
+        const __m256i counts = _mm256_and_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(int(end)), self),
+            _mm256_loadu_si256((const __m256i*)&grid.neighbourCounts[block]));
+        const __m256i lists = _mm256_mullo_epi32(self, _mm256_set1_epi32(int(CrowdGrid::NEIGHBOUR_STRIDE)));
+        const __m256 px = _mm256_loadu_ps(&grid.x[block]);
+        const __m256 py = _mm256_loadu_ps(&grid.y[block]);
+        const __m256 pvx = _mm256_loadu_ps(&grid.vx[block]);
+        const __m256 pvy = _mm256_loadu_ps(&grid.vy[block]);
+        __m256 pushX = zero, pushY = zero, steerX = zero, steerY = zero;
+        for (int k = 0; k < CROWD_MAX_NEIGHBOURS; k++)
+        {
+            const __m256i activeLanes = _mm256_cmpgt_epi32(counts, _mm256_set1_epi32(k));
+            if (_mm256_testz_si256(activeLanes, activeLanes)) break;
+            const __m256 active = _mm256_castsi256_ps(activeLanes);
+            const __m256i other = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*)grid.neighbours.data() + k,
+                lists, activeLanes, 4);
+            __m256 dx = _mm256_sub_ps(px, _mm256_mask_i32gather_ps(zero, grid.x.data(), other, active, 4));
+            __m256 dy = _mm256_sub_ps(py, _mm256_mask_i32gather_ps(zero, grid.y.data(), other, active, 4));
+            __m256 distanceSq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+
+            // Agents stacked exactly on top of each other split along x, in opposite directions
+            const __m256 stacked = _mm256_cmp_ps(distanceSq, _mm256_set1_ps(1e-6f), _CMP_LT_OQ);
+            const __m256 split = _mm256_blendv_ps(_mm256_set1_ps(-1e-3f), _mm256_set1_ps(1e-3f),
+                _mm256_castsi256_ps(_mm256_cmpgt_epi32(other, self)));
+            dx = _mm256_blendv_ps(dx, split, stacked);
+            dy = _mm256_andnot_ps(stacked, dy);
+            distanceSq = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+
+            // Lanes are masked rather than branched on, so what a masked-out lane computes never makes it into the sums
+            const __m256 overlapping = _mm256_cmp_ps(distanceSq, minDistanceSq, _CMP_LT_OQ);
+            const __m256 distance = _mm256_sqrt_ps(distanceSq);
+            const __m256 pushScale = _mm256_and_ps(_mm256_and_ps(active, overlapping),
+                _mm256_div_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(minDistance), distance), _mm256_set1_ps(0.5f)), distance));
+            pushX = _mm256_add_ps(pushX, _mm256_mul_ps(dx, pushScale));
+            pushY = _mm256_add_ps(pushY, _mm256_mul_ps(dy, pushScale));
+
+            // Time until the discs touch, given both keep their last velocities
+            const __m256 wx = _mm256_sub_ps(pvx, _mm256_mask_i32gather_ps(zero, grid.vx.data(), other, active, 4));
+            const __m256 wy = _mm256_sub_ps(pvy, _mm256_mask_i32gather_ps(zero, grid.vy.data(), other, active, 4));
+            const __m256 a = _mm256_add_ps(_mm256_mul_ps(wx, wx), _mm256_mul_ps(wy, wy));
+            const __m256 b = _mm256_add_ps(_mm256_mul_ps(dx, wx), _mm256_mul_ps(dy, wy));
+            const __m256 c = _mm256_sub_ps(distanceSq, minDistanceSq);
+            const __m256 discriminant = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(a, c));
+            __m256 avoiding = _mm256_andnot_ps(overlapping, active);
+            avoiding = _mm256_and_ps(avoiding, _mm256_cmp_ps(b, zero, _CMP_LT_OQ));
+            avoiding = _mm256_and_ps(avoiding, _mm256_cmp_ps(a, _mm256_set1_ps(1e-6f), _CMP_GE_OQ));
+            avoiding = _mm256_and_ps(avoiding, _mm256_cmp_ps(discriminant, zero, _CMP_GT_OQ));
+            const __m256 t = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(zero, b), _mm256_sqrt_ps(_mm256_max_ps(discriminant, zero))),
+                _mm256_max_ps(a, _mm256_set1_ps(1e-6f)));
+            avoiding = _mm256_and_ps(avoiding, _mm256_cmp_ps(t, _mm256_set1_ps(CROWD_HORIZON), _CMP_LT_OQ));
+
+            // Steer away along the line between the two at the moment they'd touch
+            const __m256 awayX = _mm256_add_ps(dx, _mm256_mul_ps(wx, t));
+            const __m256 awayY = _mm256_add_ps(dy, _mm256_mul_ps(wy, t));
+            const __m256 awayLengthSq = _mm256_add_ps(_mm256_mul_ps(awayX, awayX), _mm256_mul_ps(awayY, awayY));
+            avoiding = _mm256_and_ps(avoiding, _mm256_cmp_ps(awayLengthSq, zero, _CMP_GT_OQ));
+            const __m256 strength = _mm256_and_ps(avoiding, _mm256_div_ps(
+                _mm256_mul_ps(_mm256_set1_ps(CROWD_AVOIDANCE * 0.5f), _mm256_sub_ps(_mm256_set1_ps(CROWD_HORIZON), t)),
+                _mm256_mul_ps(_mm256_add_ps(t, _mm256_set1_ps(0.1f)), _mm256_sqrt_ps(awayLengthSq))));
+            steerX = _mm256_add_ps(steerX, _mm256_mul_ps(awayX, strength));
+            steerY = _mm256_add_ps(steerY, _mm256_mul_ps(awayY, strength));
+        }
+
+        // MoveAgent, 8 lanes at a time
+        const __m256i valid = _mm256_cmpgt_epi32(_mm256_set1_epi32(int(end)), self);
+        const __m256i agent = _mm256_maskload_epi32((const int*)&grid.order[block], valid);
+        const __m256 maxSpeed = _mm256_mul_ps(_mm256_i32gather_ps(agents.speeds.data(), agent, 4), _mm256_set1_ps(TILE_WIDTH * 2.0f));
+        __m256 velocityX = _mm256_mul_ps(_mm256_sub_ps(_mm256_i32gather_ps(agents.targetX.data(), agent, 4), px), _mm256_set1_ps(1.0f / dt));
+        __m256 velocityY = _mm256_mul_ps(_mm256_sub_ps(_mm256_i32gather_ps(agents.targetY.data(), agent, 4), py), _mm256_set1_ps(1.0f / dt));
+        auto limit = [&]()
+        {
+            const __m256 speed = _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(velocityX, velocityX), _mm256_mul_ps(velocityY, velocityY)));
+            const __m256 scale = _mm256_blendv_ps(_mm256_set1_ps(1.0f), _mm256_div_ps(maxSpeed, speed), _mm256_cmp_ps(speed, maxSpeed, _CMP_GT_OQ));
+            velocityX = _mm256_mul_ps(velocityX, scale);
+            velocityY = _mm256_mul_ps(velocityY, scale);
+        };
+        limit();
+        velocityX = _mm256_add_ps(velocityX, steerX);
+        velocityY = _mm256_add_ps(velocityY, steerY);
+        limit();
+
+        alignas(32) int32_t agentIds[8];
+        alignas(32) float results[4][8];
+        _mm256_store_si256((__m256i*)agentIds, agent);
+        _mm256_store_ps(results[0], velocityX);
+        _mm256_store_ps(results[1], velocityY);
+        _mm256_store_ps(results[2], _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_add_ps(px, _mm256_mul_ps(velocityX, _mm256_set1_ps(dt))), pushX), zero), _mm256_set1_ps(TILE_COUNT * TILE_WIDTH)));
+        _mm256_store_ps(results[3], _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_add_ps(py, _mm256_mul_ps(velocityY, _mm256_set1_ps(dt))), pushY), zero), _mm256_set1_ps(TILE_COUNT * TILE_HEIGHT)));
+        for (size_t lane = 0; lane < min<size_t>(8, end - block); lane++)
+        {
+            const int32_t i = agentIds[lane];
+            agents.vx[i] = results[0][lane];
+            agents.vy[i] = results[1][lane];
+            agents.x[i] = results[2][lane];
+            agents.y[i] = results[3][lane];
+        }
+    }
+#else
+    for (size_t slot = begin; slot < end; slot++)
+    {
+        const float px = grid.x[slot];
+        const float py = grid.y[slot];
+        const float pvx = grid.vx[slot];
+        const float pvy = grid.vy[slot];
+        const uint32_t* nearby = &grid.neighbours[slot * CrowdGrid::NEIGHBOUR_STRIDE];
+
+        Vector2 steer{ 0.0f, 0.0f };
+        Vector2 push{ 0.0f, 0.0f };
+        for (uint32_t n = 0; n < grid.neighbourCounts[slot]; n++)
+        {
+            const uint32_t other = nearby[n];
+            float dx = px - grid.x[other];
+            float dy = py - grid.y[other];
+            float distanceSq = dx * dx + dy * dy;
+
+            // Agents stacked exactly on top of each other split along x, in opposite directions
+            if (distanceSq < 1e-6f)
+            {
+                dx = slot < other ? 1e-3f : -1e-3f;
+                dy = 0.0f;
+                distanceSq = dx * dx;
+            }
+
+            if (distanceSq < minDistance * minDistance)
+            {
+                const float distance = sqrtf(distanceSq);
+                push = Vector2Add(push, Vector2Scale({ dx, dy }, (minDistance - distance) * 0.5f / distance));
+                continue;
+            }
+
+            // Time until the discs touch, given both keep their last velocities
+            const float wx = pvx - grid.vx[other];
+            const float wy = pvy - grid.vy[other];
+            const float a = wx * wx + wy * wy;
+            const float b = dx * wx + dy * wy;
+            const float c = distanceSq - minDistance * minDistance;
+            const float discriminant = b * b - a * c;
+            if (b >= 0.0f || a < 1e-6f || discriminant <= 0.0f) continue;
+
+            const float t = (-b - sqrtf(discriminant)) / a;
+            if (t >= CROWD_HORIZON) continue;
+
+            // Steer away along the line between the two at the moment they'd touch
+            const Vector2 away = Vector2Normalize({ dx + wx * t, dy + wy * t });
+            const float strength = CROWD_AVOIDANCE * (CROWD_HORIZON - t) / (t + 0.1f) * 0.5f;
+            steer = Vector2Add(steer, Vector2Scale(away, strength));
+        }
+        MoveAgent(agents, grid, slot, steer, push, dt);
+    }
+#endif
+}
+
+// Advances every agent one tick, spread over the pool: path targets first, then finding each agent's neighbours, then
+// steering around them
+void StepAgents(Agents& agents, CrowdGrid& grid, WorkerPool& pool, bool steering, float dt)
+{
+    constexpr size_t grain = 1024;
+    pool.ParallelFor(agents.Count(), grain, [&](size_t begin, size_t end)
+    {
+        agents.Update(dt, begin, end);
+    });
+
+    if (!steering)
+    {
+        agents.x = agents.targetX;
+        agents.y = agents.targetY;
+        return;
+    }
+
+    grid.Build(agents);
+    pool.ParallelFor(agents.Count(), grain, [&](size_t begin, size_t end)
+    {
+        FindNeighbours(grid, begin, end);
+    });
+    pool.ParallelFor(agents.Count(), grain, [&](size_t begin, size_t end)
+    {
+        SteerAgents(agents, grid, dt, begin, end);
+    });
+}
+
+// Labels stop being readable once tiles get smaller than this on screen
+constexpr float LABEL_MIN_TILE_PIXELS = 48.0f;
+
+// F-score labels of the last search. Text is only formatted when the search result changes, then baked into a
+// texture so drawing them is a single quad. Worlds too big for one texture draw the cached strings directly instead.
+struct ScoreLabels
+{
+    void Load()
+    {
+        const float width = TILE_COUNT * TILE_WIDTH;
+        const float height = TILE_COUNT * TILE_HEIGHT;
+        baked = width <= LABEL_TEXTURE_MAX && height <= LABEL_TEXTURE_MAX;
+        if (baked)
+            texture = LoadRenderTexture((int)width, (int)height);
+    }
+
+    void Unload()
+    {
+        if (baked)
+            UnloadRenderTexture(texture);
+    }
+
+    void Rebuild(const SearchTrace& trace)
+    {
+        cells.clear();
+        text.clear();
+        for (const Node& node : trace.nodes)
+        {
+            if (node.cell.col < 0) continue;
+            cells.push_back(node.cell);
+            text.emplace_back();
+            snprintf(text.back().data(), text.back().size(), "F: %.2f", node.g + node.h);
+        }
+        dirty = true;
+    }
+
+    void Update()
+    {
+        if (!baked || !dirty) return;
+
+        BeginTextureMode(texture);
+        ClearBackground(BLANK);
+        DrawCached();
+        EndTextureMode();
+        dirty = false;
+    }
+
+    void Draw(const Camera2D& camera) const
+    {
+        if (TILE_WIDTH * camera.zoom < LABEL_MIN_TILE_PIXELS) return;
+
+        if (baked)
+        {
+            const Rectangle source{ 0.0f, 0.0f, (float)texture.texture.width, -(float)texture.texture.height };
+            DrawTextureRec(texture.texture, source, { 0.0f, 0.0f }, WHITE);
+        }
+        else
+        {
+            DrawCached(VisibleTiles(camera));
+        }
+    }
+
+    void DrawCached(TileRect visible = { 0, 0, TILE_COUNT - 1, TILE_COUNT - 1 }) const
+    {
+        for (size_t i = 0; i < cells.size(); i++)
+        {
+            if (!visible.Contains(cells[i])) continue;
+            const Vector2 position = TileCenter(cells[i]);
+            DrawText(text[i].data(), position.x, position.y, 10, MAROON);
+        }
+    }
+
+    vector<Cell> cells;
+    vector<array<char, 16>> text;
+    RenderTexture2D texture{};
+    bool baked = false;
+    bool dirty = true;
+};
+
+// Expansion heatmap of the first "step" pops in the trace, with the pop at "step" outlined
+void DrawTraceHeatmap(const SearchTrace& trace, size_t step, TileRect visible)
+{
+    vector<int> counts(TILE_COUNT * TILE_COUNT, 0);
+    int maxCount = 1;
+    for (size_t i = 0; i < step && i < trace.Count(); i++)
+    {
+        const size_t index = trace.Event(i).index & ~TRACE_STALE;
+        maxCount = max(maxCount, ++counts[index]);
+    }
+
+    for (int row = visible.minRow; row <= visible.maxRow; row++)
+    {
+        for (int col = visible.minCol; col <= visible.maxCol; col++)
+        {
+            Cell cell{ col, row };
+            const int count = counts[Index(cell)];
+            if (count > 0)
+                DrawTile(cell, Fade(ORANGE, 0.25f + 0.6f * count / (float)maxCount));
+        }
+    }
+
+    if (step < trace.Count())
+    {
+        const TraceEvent& event = trace.Event(step);
+        const size_t index = event.index & ~TRACE_STALE;
+        const Cell cell{ int(index % TILE_COUNT), int(index / TILE_COUNT) };
+        DrawRectangleLinesEx({ cell.col * TILE_WIDTH, cell.row * TILE_HEIGHT, TILE_WIDTH, TILE_HEIGHT }, 3.0f,
+            (event.index & TRACE_STALE) ? GRAY : PURPLE);
+    }
+}
+
+void DrawTraceControls(const SearchTrace& trace, int& step, bool& heatmap)
+{
+    ImGui::Separator();
+    ImGui::Checkbox("Expansion heatmap", &heatmap);
+    ImGui::SliderInt("Trace step", &step, 0, (int)trace.Count());
+    ImGui::SameLine();
+    if (ImGui::Button("<") && step > 0) step--;
+    ImGui::SameLine();
+    if (ImGui::Button(">") && step < (int)trace.Count()) step++;
+
+    if (trace.total > trace.Count())
+        ImGui::Text("Showing the last %zu of %zu pops", trace.Count(), trace.total);
+    if (step < (int)trace.Count())
+    {
+        const TraceEvent& event = trace.Event(step);
+        const size_t index = event.index & ~TRACE_STALE;
+        ImGui::Text("Pop %i: row %zu, col %zu, g %.2f, h %.2f, f %.2f%s", step, index / TILE_COUNT, index % TILE_COUNT,
+            event.g, event.h, event.g + event.h, (event.index & TRACE_STALE) ? " (stale)" : "");
+    }
+}
+
+// Loads a MovingAI grid map (https://movingai.com/benchmarks/grids.html) at its own size. Passable terrain becomes
+// air, everything else (including rows cut short) is mountain.
+bool LoadMovingAiMap(const char* path, TileGrid& grid)
+{
+    ifstream file(path);
+    string token;
+    int width = 0;
+    int height = 0;
+    while (file >> token && token != "map")
+    {
+        if (token == "width") file >> width;
+        else if (token == "height") file >> height;
+    }
+    if (!file || width <= 0 || height <= 0 || width > 65536 || height > 65536)
+    {
+        printf("Couldn't read %s\n", path);
+        return false;
+    }
+
+    grid.width = width;
+    grid.height = height;
+    grid.tiles.assign(size_t(width) * height, MOUNTAIN);
+    for (int row = 0; row < height && file >> token; row++)
+    {
+        for (int col = 0; col < width && col < (int)token.size(); col++)
+        {
+            const char tile = token[col];
+            grid.tiles[grid.Index({ col, row })] = tile == '.' || tile == 'G' || tile == 'S' ? AIR : MOUNTAIN;
+        }
+    }
+    return true;
+}
+
+// The same into a Map, with any space past the map's edges as mountain
+bool LoadMovingAiMap(const char* path, Map& map)
+{
+    TileGrid grid;
+    if (!LoadMovingAiMap(path, grid)) return false;
+    if (grid.width > TILE_COUNT || grid.height > TILE_COUNT)
+    {
+        printf("%s is %ix%i but maps are %ix%i, rebuild with a larger TILE_COUNT\n", path, grid.width, grid.height, TILE_COUNT, TILE_COUNT);
+        return false;
+    }
+
+    for (auto& row : map)
+        row.fill(MOUNTAIN);
+    for (int row = 0; row < grid.height; row++)
+    {
+        for (int col = 0; col < grid.width; col++)
+            map[row][col] = grid.tiles[grid.Index({ col, row })];
+    }
+    return true;
+}
+
+// Loads the start & goal of every agent in a MovingAI MAPF scenario (https://movingai.com/benchmarks/mapf.html)
+bool LoadMovingAiScenario(const char* path, vector<Cell>& starts, vector<Cell>& goals)
+{
+    ifstream file(path);
+    string line;
+    if (!getline(file, line))
+    {
+        printf("Couldn't read %s\n", path);
+        return false;
+    }
+
+    // bucket map width height startX startY goalX goalY optimalLength
+    while (getline(file, line))
+    {
+        char mapName[256];
+        int bucket, width, height;
+        Cell start, goal;
+        if (sscanf(line.c_str(), "%d %255s %d %d %d %d %d %d", &bucket, mapName, &width, &height,
+            &start.col, &start.row, &goal.col, &goal.row) != 8) continue;
+        starts.push_back(start);
+        goals.push_back(goal);
+    }
+    return !starts.empty();
+}
+
+// Sunshine --mapf map.map scenario.scen [scenario.scen ...]
+// Solves the first 2, 4, 6... agents of every scenario with CBS, 4-connected with unit costs as the benchmark expects,
+// and reports the success rate within CBS_TIME_LIMIT ms along with time & search effort, until nothing gets solved.
+int RunMapfBenchmark(const char* mapPath, const vector<string>& scenarioPaths)
+{
+    auto map = make_shared<Map>();
+    if (!LoadMovingAiMap(mapPath, *map)) return 1;
+
+    vector<vector<Cell>> starts;
+    vector<vector<Cell>> goals;
+    size_t maxAgents = 0;
+    for (const string& path : scenarioPaths)
+    {
+        vector<Cell> scenarioStarts;
+        vector<Cell> scenarioGoals;
+        if (!LoadMovingAiScenario(path.c_str(), scenarioStarts, scenarioGoals)) continue;
+        maxAgents = max(maxAgents, scenarioStarts.size());
+        starts.push_back(move(scenarioStarts));
+        goals.push_back(move(scenarioGoals));
+    }
+    if (starts.empty())
+    {
+        printf("No scenarios to run\n");
+        return 1;
+    }
+
+    printf("%6s %9s %10s %12s %12s %10s\n", "Agents", "Success", "Mean ms", "Nodes", "Low-level", "Bypasses");
+    for (size_t agents = 2; agents <= maxAgents; agents += 2)
+    {
+        size_t attempted = 0;
+        size_t solved = 0;
+        double milliseconds = 0.0;
+        size_t nodes = 0;
+        size_t lowLevel = 0;
+        size_t bypasses = 0;
+        for (size_t s = 0; s < starts.size(); s++)
+        {
+            if (starts[s].size() < agents) continue;
+
+            const vector<Cell> scenarioStarts(starts[s].begin(), starts[s].begin() + agents);
+            const vector<Cell> scenarioGoals(goals[s].begin(), goals[s].begin() + agents);
+            CbsStats stats;
+            PlanCbs(*map, scenarioStarts, scenarioGoals, true, false, CBS_TIME_LIMIT, &stats);
+
+            attempted++;
+            solved += stats.solved;
+            milliseconds += stats.milliseconds;
+            nodes += stats.expandedNodes;
+            lowLevel += stats.lowLevelSearches;
+            bypasses += stats.bypasses;
+        }
+
+        printf("%6zu %8.0f%% %10.1f %12zu %12zu %10zu\n", agents, 100.0 * solved / attempted, milliseconds / attempted,
+            nodes / attempted, lowLevel / attempted, bypasses / attempted);
+        if (solved == 0) break;
+    }
+    return 0;
+}
+
+// Times a whole-map distance field built by sequential Dijkstra & by delta-stepping with 1, 2, 4... threads up to the
+// core count, & checks they agree. Delta-stepping does more relaxations than Dijkstra, so whether it wins at all depends
+// on the map & the cores; the sweep reports both speedups rather than assuming one. The map runs at its own size,
+// whatever TILE_COUNT is.
+int RunDistanceFieldBenchmark(const char* mapPath)
+{
+    TileGrid grid;
+    if (!LoadMovingAiMap(mapPath, grid)) return 1;
+    printf("%s: %ix%i tiles\n", mapPath, grid.width, grid.height);
+
+    const unsigned int cores = max(1u, thread::hardware_concurrency());
+    vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < cores; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(cores);
+
+    printf("%10s %8s %12s %10s %12s %12s %11s\n", "Heuristic", "Threads", "Dijkstra ms", "Delta ms", "vs Dijkstra",
+        "vs 1 thread", "Mismatches");
+    for (bool manhattan : { true, false })
+    {
+        const Cell goal{ grid.width / 2, grid.height / 2 };
+        double sequentialMilliseconds = DBL_MAX;
+        vector<float> sequential;
+        for (int run = 0; run < 3; run++)
+        {
+            const auto runStart = chrono::steady_clock::now();
+            sequential = DistancesToGoal(grid, goal, manhattan);
+            sequentialMilliseconds = min(sequentialMilliseconds, chrono::duration<double, milli>(chrono::steady_clock::now() - runStart).count());
+        }
+
+        double singleThreadMilliseconds = 0.0;
+        for (unsigned int threads : threadCounts)
+        {
+            WorkerPool pool;
+            pool.Start(threads - 1);
+            double parallelMilliseconds = DBL_MAX;
+            vector<float> parallel;
+            for (int run = 0; run < 3; run++)
+            {
+                const auto runStart = chrono::steady_clock::now();
+                parallel = DistancesToGoal(grid, goal, manhattan, pool);
+                parallelMilliseconds = min(parallelMilliseconds, chrono::duration<double, milli>(chrono::steady_clock::now() - runStart).count());
+            }
+            pool.Stop();
+            if (threads == 1)
+                singleThreadMilliseconds = parallelMilliseconds;
+
+            size_t mismatches = 0;
+            for (size_t i = 0; i < sequential.size(); i++)
+                mismatches += sequential[i] != parallel[i];
+            printf("%10s %8u %12.1f %10.1f %11.2fx %11.2fx %11zu\n", manhattan ? "Manhattan" : "Euclidean", threads,
+                sequentialMilliseconds, parallelMilliseconds, sequentialMilliseconds / parallelMilliseconds,
+                singleThreadMilliseconds / parallelMilliseconds, mismatches);
+        }
+    }
+    if (cores == 1)
+        printf("Only one core available, so multi-core scaling wasn't measured\n");
+    return 0;
+}
+
+// Sunshine --wavefront map.map [queries]
+// Times Wavefront against QueueBfs on the map at its own size, building whole fields from random passable tiles & then
+// finding paths between random pairs of them, & checks the step counts agree. FindPath answers the same path queries
+// when the map fits in TILE_COUNT, as a vehicle (mountains are walls & air is free), so it searches the same tiles.
+int RunWavefrontBenchmark(const char* mapPath, int queryCount)
+{
+    TileGrid grid;
+    if (!LoadMovingAiMap(mapPath, grid)) return 1;
 
-using Map = array<array<size_t, TILE_COUNT>, TILE_COUNT>;
+    TileBits passable(grid.width, grid.height);
+    vector<Cell> open;
+    for (int row = 0; row < grid.height; row++)
+    {
+        for (int col = 0; col < grid.width; col++)
+        {
+            if (grid.tiles[grid.Index({ col, row })] == MOUNTAIN) continue;
+            passable.Set({ col, row });
+            open.push_back({ col, row });
+        }
+    }
+    if (open.empty())
+    {
+        printf("%s has no passable tiles\n", mapPath);
+        return 1;
+    }
+
+    mt19937 random(1);
+    vector<Cell> starts;
+    vector<Cell> goals;
+    for (int i = 0; i < queryCount; i++)
+    {
+        starts.push_back(open[random() % open.size()]);
+        goals.push_back(open[random() % open.size()]);
+    }
+    printf("%s: %ix%i tiles, %zu passable, %i queries\n", mapPath, grid.width, grid.height, open.size(), queryCount);
+
+    auto milliseconds = [](chrono::steady_clock::time_point since)
+    {
+        return chrono::duration<double, milli>(chrono::steady_clock::now() - since).count();
+    };
+
+    // Whole fields
+    Wavefront wavefront;
+    vector<uint32_t> distances;
+    size_t fieldMismatches = 0;
+    double wavefrontFields = 0.0;
+    double queueFields = 0.0;
+    for (const Cell& start : starts)
+    {
+        auto begin = chrono::steady_clock::now();
+        wavefront.Run(passable, start, true);
+        wavefrontFields += milliseconds(begin);
+
+        begin = chrono::steady_clock::now();
+        QueueBfs(grid, start, { -1, -1 }, distances);
+        queueFields += milliseconds(begin);
+        fieldMismatches += distances != wavefront.distances;
+    }
+
+    // Paths, stopping at the goal. The queue BFS walks back down its distances the same way PathTo does.
+    size_t pathMismatches = 0;
+    double wavefrontPaths = 0.0;
+    double queuePaths = 0.0;
+    for (int i = 0; i < queryCount; i++)
+    {
+        auto begin = chrono::steady_clock::now();
+        wavefront.Run(passable, starts[i], true, goals[i]);
+        const vector<Cell> wavefrontPath = wavefront.PathTo(goals[i]);
+        wavefrontPaths += milliseconds(begin);
+
+        begin = chrono::steady_clock::now();
+        QueueBfs(grid, starts[i], goals[i], distances);
+        vector<Cell> queuePath;
+        if (distances[grid.Index(goals[i])] != UINT32_MAX)
+        {
+            queuePath.push_back(goals[i]);
+            for (Cell current = goals[i]; distances[grid.Index(current)] > 0; queuePath.push_back(current))
+            {
+                for (const Cell& move : MOVES)
+                {
+                    const Cell neighbour{ current.col + move.col, current.row + move.row };
+                    if (grid.InBounds(neighbour) && distances[grid.Index(neighbour)] == distances[grid.Index(current)] - 1)
+                    {
+                        current = neighbour;
+                        break;
+                    }
+                }
+            }
+            reverse(queuePath.begin(), queuePath.end());
+        }
+        queuePaths += milliseconds(begin);
+        pathMismatches += wavefrontPath.size() != queuePath.size();
+    }
+
+    printf("%-10s %14s %14s %11s\n", "Method", "Field ms", "Path ms", "Mismatches");
+    printf("%-10s %14.3f %14.3f %11s\n", "Wavefront", wavefrontFields / queryCount, wavefrontPaths / queryCount, "");
+    printf("%-10s %14.3f %14.3f %11zu\n", "Queue BFS", queueFields / queryCount, queuePaths / queryCount,
+        fieldMismatches + pathMismatches);
+
+    if (grid.width > TILE_COUNT || grid.height > TILE_COUNT)
+    {
+        printf("FindPath skipped: the map is bigger than this build's %ix%i\n", TILE_COUNT, TILE_COUNT);
+        return 0;
+    }
+
+    auto map = make_shared<Map>();
+    for (auto& row : *map)
+        row.fill(MOUNTAIN);
+    for (int row = 0; row < grid.height; row++)
+    {
+        for (int col = 0; col < grid.width; col++)
+            (*map)[row][col] = grid.tiles[grid.Index({ col, row })];
+    }
+    auto vehicle = make_unique<ProfileCache>();
+    vehicle->Build(*map, MapVersion(*map), VEHICLE_PROFILE);
+
+    // Reachability is all it can disagree with the BFS on, as its paths are shortest by distance rather than steps
+    size_t findPathMismatches = 0;
+    double findPathPaths = 0.0;
+    for (int i = 0; i < queryCount; i++)
+    {
+        const auto begin = chrono::steady_clock::now();
+        const vector<Cell> path = FindPath(starts[i], goals[i], *vehicle, false);
+        findPathPaths += milliseconds(begin);
+
+        wavefront.Run(passable, starts[i], true, goals[i]);
+        findPathMismatches += path.empty() != (wavefront.Distance(goals[i]) == UINT32_MAX);
+    }
+    printf("%-10s %14s %14.3f %11zu\n", "FindPath", "", findPathPaths / queryCount, findPathMismatches);
+    return 0;
+}
 
-enum TileType : size_t
+// Sunshine --crowd [agents] [ticks]
+// Steps a crowd with steering on 1, 2, 4... threads up to the core count & reports tick times against a 2 ms budget.
+// Agents are spread over every row of the map, alternate rows walking in opposite directions.
+int RunCrowdBenchmark(int agentCount, int ticks)
 {
-    AIR,
-    GRASS,
-    WATER,
-    MUD,
-    MOUNTAIN,
-    COUNT
-};
+    constexpr double budget = 2.0;
+    Agents start;
+    for (int row = 0; row < TILE_COUNT; row++)
+    {
+        vector<Cell> path;
+        for (int col = 0; col < TILE_COUNT; col++)
+            path.push_back({ row % 2 == 0 ? col : TILE_COUNT - 1 - col, row });
+        SpawnAgents(start, path, agentCount / TILE_COUNT + (row < agentCount % TILE_COUNT));
+    }
+
+    const unsigned int cores = max(1u, thread::hardware_concurrency());
+    vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < cores; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(cores);
+
+    printf("%zu agents on %ix%i tiles, %i ticks at %i Hz\n", start.Count(), TILE_COUNT, TILE_COUNT, ticks, SIMULATION_HZ);
+    printf("%8s %10s %10s %10s %12s\n", "Threads", "Mean ms", "p99 ms", "Worst ms", "Over budget");
+    for (unsigned int threads : threadCounts)
+    {
+        Agents agents = start;
+        CrowdGrid grid;
+        WorkerPool pool;
+        pool.Start(threads - 1);
+
+        // The first ticks pull a spawned crowd apart, then it settles into what a running game sees
+        vector<double> times;
+        for (int tick = 0; tick < ticks + SIMULATION_HZ; tick++)
+        {
+            const auto tickStart = chrono::steady_clock::now();
+            StepAgents(agents, grid, pool, true, 1.0f / SIMULATION_HZ);
+            if (tick >= SIMULATION_HZ)
+                times.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - tickStart).count());
+        }
+        pool.Stop();
+
+        const double total = accumulate(times.begin(), times.end(), 0.0);
+        const size_t over = count_if(times.begin(), times.end(), [budget](double time) { return time > budget; });
+        sort(times.begin(), times.end());
+        printf("%8u %10.2f %10.2f %10.2f %12zu\n", threads, total / times.size(), times[size_t(0.99 * (times.size() - 1))],
+            times.back(), over);
+    }
+    if (cores == 1)
+        printf("Only one core available, so multi-core scaling wasn't measured\n");
+    return 0;
+}
 
-struct Cell
+// A single tile painted in the editor
+struct MapEdit
 {
-    int col = -1;
-    int row = -1;
+    Cell cell;
+    TileType type;
 };
 
-float Manhattan(Cell a, Cell b)
-{
-    return abs(b.col - a.col) + abs(b.row - a.row);
-}
+struct World;
+
+// Work too slow to fit in a tick. Runs on the simulation's job thread with copies of whatever it needs, then returns the
+// command that applies its result to the world on a later tick.
+using Job = function<function<void(World&)>()>;
 
-float Euclidean(Cell a, Cell b)
+// Everything the simulation thread owns. Only ever touched by simulation ticks & the commands they run.
+struct World
 {
-    return sqrtf(powf(b.col - a.col, 2.0f) + powf(b.row - a.row, 2.0f));
-    //return sqrtf((b.col - a.col) * (b.col - a.col) + (b.row - a.row) * (b.row - a.row));
-    // Identical to the above implementation
-}
+    // Edits replace the map rather than modify it, so snapshots handed to the renderer never change underneath it
+    shared_ptr<const Map> map;
+    uint64_t mapVersion = 0;
+    uint64_t publishedVersion = 0;  // Map version in the last snapshot
+    vector<Cell> changes;           // Tiles changed since the last snapshot
 
-// From game world to graph world "Quantization"
-Cell ScreenToTile(Vector2 position)
+    Agents agents;
+    uint32_t agentsGeneration = 0;  // Bumped whenever agents are added or removed, so the renderer knows not to interpolate
+    CrowdGrid crowd;
+    bool steering = true;
+
+    // Only the most recent request is kept, so dragging a slider doesn't queue up a search per frame
+    PathRequest request;
+    bool requestPending = false;
+    shared_ptr<const vector<Cell>> path = make_shared<vector<Cell>>();
+    shared_ptr<const SearchTrace> trace = make_shared<SearchTrace>();
+    SearchStats stats;
+    float pathCost = 0.0f;          // Cost of path under the profile & heuristic it was planned with
+    size_t queries = 0;
+
+    // Edits to the map repair the current A* path rather than searching again. The repairer is only set up on the
+    // first edit after a query, seeded with that query's search (repairSeed) on the map as it was then (repairBase).
+    PathRepair repair;
+    shared_ptr<const Map> repairBase;
+    shared_ptr<const SearchTrace> repairSeed;
+    vector<Cell> repairChanges;
+    bool repairPending = false;
+
+    // Grid queries with anytime set keep improving their path over the following ticks
+    AnytimeSearch anytime;
+
+    CompressedPathDatabase cpd;
+    vector<ProfileCache> profiles = vector<ProfileCache>(PROFILE_COUNT);
+    QueryLog log;
+    CooperativeStats cooperative;  // Last cooperative group planned
+    CbsStats cbs;                  // Last optimal group planned
+
+    vector<Job> jobs;               // Queued by commands, handed to the job thread at the end of the tick
+    size_t jobsRunning = 0;         // Queued jobs whose results haven't been applied yet
+
+    History tickTimes;
+    History pathTimes;
+    History crowdTimes;
+};
+
+// A CPD only answers queries on the map & heuristic it was built for, by single-tile agents with standard costs
+bool UsesCpd(const World& world)
 {
-    return { int(position.x / TILE_WIDTH), int(position.y / TILE_HEIGHT) };
+    return world.request.useCpd && !world.cpd.Empty() && world.cpd.mapVersion == world.mapVersion &&
+        world.cpd.manhattan == world.request.manhattan && world.request.agentSize == 1 &&
+        world.request.profile == STANDARD_PROFILE && world.request.nearest < 0;
 }
 
-// From graph world to game world "Localization"
-Vector2 TileToScreen(Cell cell)
+// Queries that go through standard-cost grid A* (rather than a CPD, the subgoal graph or an any-angle search) can be
+// repaired incrementally
+bool UsesGridSearch(const World& world)
 {
-    return { cell.col * TILE_WIDTH, cell.row * TILE_HEIGHT };
+    return !UsesCpd(world) && !world.request.useSubgoals && world.request.shape == GRID_PATH && world.request.agentSize == 1 &&
+        world.request.profile == STANDARD_PROFILE && world.request.weight == 1.0f && !world.request.anytime &&
+        world.request.nearest < 0;
 }
 
-Vector2 TileCenter(Cell cell)
+// Hands a query's path to the renderer, costed with the profile & heuristic the request planned it with
+void SetPath(World& world, vector<Cell> path, const SearchStats& stats, shared_ptr<const SearchTrace> trace)
 {
-    return TileToScreen(cell) + Vector2{ TILE_WIDTH * 0.5f, TILE_HEIGHT * 0.5f };
+    const PathRequest& request = world.request;
+    world.pathCost = PathCost(path, ProfileEnterCost(world.profiles[request.profile], 1), request.manhattan);
+    world.path = make_shared<vector<Cell>>(move(path));
+    world.trace = trace != nullptr ? trace : make_shared<SearchTrace>();
+    world.stats = stats;
+    world.queries++;
 }
 
-// Go from 2d to 1d (necessary for path finding data structures)
-size_t Index(Cell cell)
+void RunPathRequest(World& world)
 {
-    return cell.row * TILE_COUNT + cell.col;
-}
+    const PathRequest& request = world.request;
+    const Map& map = *world.map;
+    world.requestPending = false;
+    world.repairPending = false;
+    world.repairBase = nullptr;
+    world.repairSeed = nullptr;
+    world.repairChanges.clear();
+    world.repair = {};
+    world.anytime.Stop();
 
-// Go from 1d to 2d
-//Cell From(size_t index)
-//{
-//    return { index % TILE_COUNT, index / TILE_COUNT };
-//}
+    SearchStats stats;
+    vector<Cell> path;
+    auto trace = make_shared<SearchTrace>();
+    ProfileCache& profile = world.profiles[request.profile];
 
-float Cost(TileType type)
-{
-    static array<float, COUNT> costs
+    if (UsesCpd(world))
     {
-        0.0f,   // AIR
-        10.0f,  // GRASS
-        25.0f,  // WATER
-        50.0f,  // MUD
-        100.0f, // MOUNTAIN
-    };
+        const auto lookupStart = chrono::steady_clock::now();
+        const size_t lookupBytes = gBytesAllocated;
+        path = FindPath(request.start, request.goal, world.cpd);
+        stats.bytesAllocated = gBytesAllocated - lookupBytes;
+        stats.milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - lookupStart).count();
+        trace = nullptr;
+    }
+    else if (UsesAnytime(request))
+    {
+        // Only the first slice runs now; the path is published once a pass finishes
+        world.anytime.Reset(request.start, request.goal, profile, request.manhattan, request.agentSize, request.weight);
+        world.anytime.Improve(ANYTIME_SLICE, path, stats);
+        trace = nullptr;
+    }
+    else
+    {
+        // Planners that don't fill in the trace leave it empty, so the heatmap & labels never show an older search
+        path = FindRequestPath(request, map, profile, &stats, trace.get());
+        if (UsesGridSearch(world))
+            world.repairSeed = trace;
+    }
 
-    return costs[type];
+    if (request.smooth)
+        path = SmoothPath(path, ProfileEnterCost(profile, request.agentSize));
+    SetPath(world, move(path), stats, trace);
+
+    // Logged as it actually ran, so a CPD that wasn't built yet replays as the grid search that answered instead
+    PathRequest logged = request;
+    logged.useCpd = UsesCpd(world);
+    world.log.Record(map, world.mapVersion, logged);
 }
 
-// Returns all adjacent cells to the passed-in cell (up, down, left, right & diagonals)
-vector<Cell> Neighbours(Cell cell)
+// Applies a change set, then either queues a repair of the current path or (for CPD/subgoal queries) a new search
+void ApplyEdits(World& world, const vector<MapEdit>& edits)
 {
-    vector<Cell> neighbours;
-    for (int row = -1; row <= 1; row++)
+    auto map = make_shared<Map>(*world.map);
+    vector<Cell> changed;
+    for (const MapEdit& edit : edits)
     {
-        for (int col = -1; col <= 1; col++)
-        {
-            // Don't add the passed-in cell to the list
-            if (row == cell.row && col == cell.col) continue;
+        if (!InBounds(edit.cell) || (*map)[edit.cell.row][edit.cell.col] == edit.type) continue;
+        (*map)[edit.cell.row][edit.cell.col] = edit.type;
+        changed.push_back(edit.cell);
+    }
+    if (changed.empty()) return;
+    const uint64_t version = MapVersion(*map);
+    for (ProfileCache& profile : world.profiles)
+        profile.Update(*map, version, changed);
 
-            Cell neighbour{ cell.col + col, cell.row + row };
-            if (neighbour.col >= 0 && neighbour.col < TILE_COUNT &&
-                neighbour.row >= 0 && neighbour.row < TILE_COUNT)
-                neighbours.push_back(neighbour);
-        }
+    if (UsesGridSearch(world))
+    {
+        if (world.repairBase == nullptr && !world.repair.Matches(world.request.start, world.request.goal, world.request.manhattan))
+            world.repairBase = world.map;
+        world.repairChanges.insert(world.repairChanges.end(), changed.begin(), changed.end());
+        world.repairPending = true;
+    }
+    else
+    {
+        world.requestPending = true;
     }
-    return neighbours;
+
+    world.map = map;
+    world.mapVersion = version;
+    world.changes.insert(world.changes.end(), changed.begin(), changed.end());
 }
 
-struct Node
+void RunPathRepair(World& world)
 {
-    Node()
-    {
-        Init();
-    }
+    const PathRequest& request = world.request;
+    world.repairPending = false;
 
-    Node(Cell cell)
+    // First edit since the query: carry on from the query's own search on the map the path was found on
+    if (world.repairBase != nullptr)
     {
-        Init(cell);
+        world.repair.Reset(request.start, request.goal, request.manhattan);
+        if (world.repairSeed != nullptr)
+            world.repair.Seed(*world.repairBase, world.repairSeed->nodes);
+        else
+            world.repair.ComputePath(*world.repairBase);
+        world.repairBase = nullptr;
+        world.repairSeed = nullptr;
     }
 
-    Node(Cell cell, float g, float h)
+    world.repair.TilesChanged(*world.map, world.repairChanges);
+    world.repairChanges.clear();
+
+    SearchStats stats;
+    vector<Cell> path = world.repair.ComputePath(*world.map, &stats);
+    if (request.smooth)
+        path = SmoothPath(path, ProfileEnterCost(world.profiles[request.profile], request.agentSize));
+    SetPath(world, move(path), stats, nullptr);
+}
+
+// Continues an anytime search for a slice, publishing the path whenever a pass finishes
+void ImproveAnytimePath(World& world)
+{
+    vector<Cell> path;
+    SearchStats stats;
+    if (!world.anytime.Improve(ANYTIME_SLICE, path, stats)) return;
+
+    if (world.request.smooth)
+        path = SmoothPath(path, ProfileEnterCost(world.profiles[world.request.profile], world.request.agentSize));
+    SetPath(world, move(path), stats, nullptr);
+}
+
+// Random distinct passable starts, & distinct goals, for a group of up to count agents. Runs on the job thread, so it
+// draws from the job's own generator rather than raylib's (rand() isn't safe to share between threads).
+void PickGroup(const Map& map, int count, mt19937& random, vector<Cell>& starts, vector<Cell>& goals)
+{
+    vector<Cell> open;
+    for (int row = 0; row < TILE_COUNT; row++)
     {
-        Init(cell, {}, g, h);
+        for (int col = 0; col < TILE_COUNT; col++)
+        {
+            if (!Blocked(map, { col, row }))
+                open.push_back({ col, row });
+        }
     }
+    count = min(count, (int)open.size());
 
-    Node(Cell cell, Cell parent, float g, float h)
+    auto pick = [&open, &random, count]()
     {
-        Init(cell, parent, g, h);
-    }
+        for (int i = 0; i < count; i++)
+            swap(open[i], open[uniform_int_distribution<int>(i, (int)open.size() - 1)(random)]);
+        return vector<Cell>(open.begin(), open.begin() + count);
+    };
+    starts = pick();
+    goals = pick();
+}
 
-    void Init(Cell cell = {}, Cell parent = {}, float g = 0.0f, float h = 0.0f)
+// Agents that follow paths one tile per step, all starting together
+void AddTimedAgents(World& world, const vector<vector<Cell>>& paths)
+{
+    for (const vector<Cell>& path : paths)
     {
-        this->cell = cell;
-        this->parent = parent;
-        this->g = g;
-        this->h = h;
+        const size_t id = world.agents.AddPath(path, true);
+        world.agents.Add(id, 0, 0.0f, 1.0f);
     }
+    world.agentsGeneration++;
+}
 
-    float F() { return g + h; }
-
-    float g;
-    float h;
+// Queues a job, counting it as running until its result has been applied
+void QueueJob(World& world, Job job)
+{
+    world.jobsRunning++;
+    world.jobs.push_back([job = move(job)]()
+    {
+        function<void(World&)> apply = job();
+        return [apply = move(apply)](World& world)
+        {
+            world.jobsRunning--;
+            apply(world);
+        };
+    });
+}
 
-    Cell cell;
-    Cell parent;
-};
+// Plans a random group together with WHCA*, so none of them ever share a tile or swap places. Planning runs as a job on
+// the map as it is now; if the map has been edited by the time it's done, the group isn't spawned.
+void SpawnCooperativeGroup(World& world, int count)
+{
+    const shared_ptr<const Map> map = world.map;
+    const uint64_t mapVersion = world.mapVersion;
+    const bool manhattan = world.request.manhattan;
+    QueueJob(world, [map, mapVersion, manhattan, count]() -> function<void(World&)>
+    {
+        mt19937 random(random_device{}());
+        vector<Cell> starts;
+        vector<Cell> goals;
+        PickGroup(*map, count, random, starts, goals);
+        CooperativeStats stats;
+        vector<vector<Cell>> paths = PlanCooperative(*map, starts, goals, manhattan, 64, &stats);
+        return [mapVersion, stats, paths](World& world)
+        {
+            world.cooperative = stats;
+            if (world.mapVersion == mapVersion)
+                AddTimedAgents(world, paths);
+        };
+    });
+}
 
-bool operator==(Cell a, Cell b)
+// Plans a random group with CBS for the cheapest collision-free paths, as a job like SpawnCooperativeGroup. Gives up
+// (spawning nothing) after CBS_UI_TIME_LIMIT ms so a hard group doesn't hold up the jobs queued behind it.
+void SpawnOptimalGroup(World& world, int count)
 {
-    return a.row == b.row && a.col == b.col;
+    const shared_ptr<const Map> map = world.map;
+    const uint64_t mapVersion = world.mapVersion;
+    const bool manhattan = world.request.manhattan;
+    QueueJob(world, [map, mapVersion, manhattan, count]() -> function<void(World&)>
+    {
+        mt19937 random(random_device{}());
+        vector<Cell> starts;
+        vector<Cell> goals;
+        PickGroup(*map, count, random, starts, goals);
+        CbsStats stats;
+        vector<vector<Cell>> paths = PlanCbs(*map, starts, goals, manhattan, true, CBS_UI_TIME_LIMIT, &stats);
+        return [mapVersion, stats, paths](World& world)
+        {
+            world.cbs = stats;
+            if (world.mapVersion == mapVersion)
+                AddTimedAgents(world, paths);
+        };
+    });
 }
 
-bool Compare(Node a, Node b)
+// Builds & saves a CPD for the current map as a job. It only answers queries while the map stays at the version it was
+// built for (see UsesCpd), so one that finishes after an edit is harmless.
+void BuildCpd(World& world, bool manhattan)
 {
-    return a.F() > b.F();
+    const shared_ptr<const Map> map = world.map;
+    const uint64_t mapVersion = world.mapVersion;
+    QueueJob(world, [map, mapVersion, manhattan]() -> function<void(World&)>
+    {
+        auto cpd = make_shared<CompressedPathDatabase>(BuildCompressedPathDatabase(*map, mapVersion, manhattan));
+        SaveCompressedPathDatabase(*cpd, "sunshine.cpd");
+        return [cpd](World& world)
+        {
+            world.cpd = move(*cpd);
+        };
+    });
 }
 
-vector<Cell> FindPath(Cell start, Cell end, Map map, bool manhattan)
+// Immutable copy of what the renderer needs from one simulation tick
+struct Snapshot
 {
-    // 1:1 mapping of graph nodes to tile map
-    const int nodeCount = TILE_COUNT * TILE_COUNT;
-    vector<Node> tileNodes(nodeCount);
-    vector<bool> closedList(nodeCount, false);
-    priority_queue<Node, vector<Node>, decltype(&Compare)> openList(Compare);
-    tileNodes[Index(start)].parent = start;
-    openList.push(start);
+    uint64_t tick = 0;
+    chrono::steady_clock::time_point time;
+
+    // Tiles in changes took the map from baseVersion to mapVersion
+    shared_ptr<const Map> map;
+    uint64_t mapVersion = 0;
+    uint64_t baseVersion = 0;
+    vector<Cell> changes;
 
-    // Loop until we've reached the goal, or explored every tile
-    while (!openList.empty())
+    uint32_t agentsGeneration = 0;
+    vector<float> x;
+    vector<float> y;
+
+    shared_ptr<const vector<Cell>> path;
+    shared_ptr<const SearchTrace> trace;
+    SearchStats stats;
+    float pathCost = 0.0f;
+    int nearest = -1;           // Tile type the path heads for instead of the goal, -1 for the goal
+    size_t queries = 0;
+    bool improving = false;     // An anytime search is still refining the path
+
+    bool logging = false;
+    bool hasCpd = false;
+    bool cpdManhattan = true;
+    size_t cpdRuns = 0;
+    size_t cpdBytes = 0;
+    size_t subgoals = 0;
+    CooperativeStats cooperative;
+    CbsStats cbs;
+    size_t jobsRunning = 0;
+
+    History tickTimes;
+    History pathTimes;
+    History crowdTimes;
+    bool steering = true;
+};
+
+// Runs the world at a fixed SIMULATION_HZ on its own thread. The render thread posts commands and reads the two most
+// recent snapshots to interpolate between, so neither side ever waits on the other for more than a pointer swap.
+// Jobs the commands queue run one at a time on a thread of their own, & post their results back as commands.
+struct Simulation
+{
+    void Start()
     {
-        const Cell currentCell = openList.top().cell;
+        world.publishedVersion = world.mapVersion;
+        Publish(0, 0.0f, 0.0f, 0.0f);
+        running = true;
+
+        // Leave a core each for the render & simulation threads
+        workers.Start(max(2u, thread::hardware_concurrency()) - 2);
+        worker = thread(&Simulation::Run, this);
+        jobThread = thread(&Simulation::RunJobs, this);
+    }
 
-        // Stop exploring once we've found the goal
-        if (currentCell == end)
-            break;
+    void Stop()
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            running = false;
+        }
+        jobReady.notify_all();
+        if (worker.joinable())
+            worker.join();
+        if (jobThread.joinable())
+            jobThread.join();
+        workers.Stop();
+    }
 
-        // Otherwise, add current cell to closed list and update g & h values of its neighbours
-        openList.pop();
-        closedList[Index(currentCell)] = true;
+    // Runs command on the simulation thread at the start of the next tick
+    void Post(function<void(World&)> command)
+    {
+        lock_guard<mutex> guard(lock);
+        commands.push_back(move(command));
+    }
 
-        float gNew, hNew;
-        for (const Cell& neighbour : Neighbours(currentCell))
+    // Runs jobs in the order they were queued. A job already running when the simulation stops is finished first.
+    void RunJobs()
+    {
+        while (true)
         {
-            const size_t neighbourIndex = Index(neighbour);
+            Job job;
+            {
+                unique_lock<mutex> guard(lock);
+                jobReady.wait(guard, [this]() { return !running || !jobs.empty(); });
+                if (!running) return;
+                job = move(jobs.front());
+                jobs.pop_front();
+            }
+            Post(job());
+        }
+    }
 
-            // Skip if already explored
-            if (closedList[neighbourIndex]) continue;
+    void Latest(shared_ptr<const Snapshot>& previousSnapshot, shared_ptr<const Snapshot>& latestSnapshot)
+    {
+        lock_guard<mutex> guard(lock);
+        previousSnapshot = previous;
+        latestSnapshot = latest;
+    }
 
-            // Calculate scores
-            gNew = manhattan ? Manhattan(currentCell, neighbour) : Euclidean(currentCell, neighbour);   // Distance from current to adjacent
-            hNew = manhattan ? Manhattan(neighbour, end) : Euclidean(neighbour, end);                   // Distance from adjacent to goal
-            hNew += Cost((TileType)map[neighbour.row][neighbour.col]);
+    void Run()
+    {
+        const auto tickLength = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(1.0 / SIMULATION_HZ));
+        auto nextTick = chrono::steady_clock::now() + tickLength;
+        for (uint64_t tick = 1; running; tick++)
+        {
+            const auto tickStart = chrono::steady_clock::now();
+            vector<function<void(World&)>> pending;
+            {
+                lock_guard<mutex> guard(lock);
+                pending.swap(commands);
+            }
+            for (function<void(World&)>& command : pending)
+                command(world);
+            if (!world.jobs.empty())
+            {
+                {
+                    lock_guard<mutex> guard(lock);
+                    move(world.jobs.begin(), world.jobs.end(), back_inserter(jobs));
+                }
+                world.jobs.clear();
+                jobReady.notify_one();
+            }
 
-            // Append if unvisited or best score
-            if (tileNodes[neighbourIndex].F() <= FLT_EPSILON /*unexplored*/ ||
-                gNew + hNew < tileNodes[neighbourIndex].F() /*better score*/)
+            float pathMilliseconds = 0.0f;
+            if (world.requestPending || world.repairPending || world.anytime.Running())
             {
-                openList.push({ neighbour, gNew, hNew });
-                tileNodes[neighbourIndex] = { neighbour, currentCell, gNew, hNew };
+                const auto pathStart = chrono::steady_clock::now();
+                if (world.requestPending)
+                    RunPathRequest(world);
+                else if (world.repairPending)
+                    RunPathRepair(world);
+                else
+                    ImproveAnytimePath(world);
+                pathMilliseconds = chrono::duration<float, milli>(chrono::steady_clock::now() - pathStart).count();
             }
+
+            const auto crowdStart = chrono::steady_clock::now();
+            StepAgents(world.agents, world.crowd, workers, world.steering, 1.0f / SIMULATION_HZ);
+            const float crowdMilliseconds = chrono::duration<float, milli>(chrono::steady_clock::now() - crowdStart).count();
+            Publish(tick, chrono::duration<float, milli>(chrono::steady_clock::now() - tickStart).count(), pathMilliseconds, crowdMilliseconds);
+
+            // Ticks that fall behind run back to back to catch up, but don't try to make up for long stalls
+            const auto now = chrono::steady_clock::now();
+            if (now - nextTick > tickLength * 8)
+                nextTick = now;
+            this_thread::sleep_until(nextTick);
+            nextTick += tickLength;
         }
     }
 
-    vector<Cell> path;
-    Cell currentCell = end;
-    size_t currentIndex = Index(currentCell);
-
-    while (!(tileNodes[currentIndex].parent == currentCell))
+    void Publish(uint64_t tick, float tickMilliseconds, float pathMilliseconds, float crowdMilliseconds)
     {
-        path.push_back(currentCell);
-        currentCell = tileNodes[currentIndex].parent;
-        currentIndex = Index(currentCell);
+        world.tickTimes.Push(tickMilliseconds);
+        world.pathTimes.Push(pathMilliseconds);
+        world.crowdTimes.Push(crowdMilliseconds);
+
+        auto snapshot = make_shared<Snapshot>();
+        snapshot->tick = tick;
+        snapshot->time = chrono::steady_clock::now();
+        snapshot->map = world.map;
+        snapshot->mapVersion = world.mapVersion;
+        snapshot->baseVersion = world.publishedVersion;
+        snapshot->changes = move(world.changes);
+        world.changes.clear();
+        world.publishedVersion = world.mapVersion;
+        snapshot->agentsGeneration = world.agentsGeneration;
+        snapshot->x = world.agents.x;
+        snapshot->y = world.agents.y;
+        snapshot->path = world.path;
+        snapshot->trace = world.trace;
+        snapshot->stats = world.stats;
+        snapshot->pathCost = world.pathCost;
+        snapshot->nearest = world.request.nearest;
+        snapshot->queries = world.queries;
+        snapshot->improving = world.anytime.Running();
+        snapshot->logging = world.log.file.is_open();
+        snapshot->hasCpd = !world.cpd.Empty();
+        snapshot->cpdManhattan = world.cpd.manhattan;
+        snapshot->cpdRuns = world.cpd.runs.size();
+        snapshot->cpdBytes = world.cpd.Bytes();
+        snapshot->subgoals = world.profiles[world.request.profile].subgoalGraphs[world.request.agentSize - 1].subgoals.size();
+        snapshot->cooperative = world.cooperative;
+        snapshot->cbs = world.cbs;
+        snapshot->jobsRunning = world.jobsRunning;
+        snapshot->tickTimes = world.tickTimes;
+        snapshot->pathTimes = world.pathTimes;
+        snapshot->crowdTimes = world.crowdTimes;
+        snapshot->steering = world.steering;
+
+        lock_guard<mutex> guard(lock);
+        previous = latest != nullptr ? latest : snapshot;
+        latest = snapshot;
     }
-    path.push_back(start);
-    reverse(path.begin(), path.end());
 
-    return path;
-}
+    World world;
+    thread worker;
+    thread jobThread;
+    WorkerPool workers;
+    atomic<bool> running{ false };
 
-void DrawTile(Cell cell, Color color)
-{
-    DrawRectangle(cell.col * TILE_WIDTH, cell.row * TILE_HEIGHT, TILE_WIDTH, TILE_HEIGHT, color);
-}
+    mutex lock;
+    vector<function<void(World&)>> commands;
+    deque<Job> jobs;
+    condition_variable jobReady;
+    shared_ptr<const Snapshot> previous;
+    shared_ptr<const Snapshot> latest;
+};
 
-void DrawTile(Cell cell, TileType type)
+// Agent positions blended between the two latest ticks. Renders one tick behind so there's always a tick to blend towards.
+void InterpolateAgents(const Snapshot& previous, const Snapshot& latest, vector<float>& x, vector<float>& y)
 {
-    Color color = WHITE;
-    switch (type)
+    const float tickLength = 1.0f / SIMULATION_HZ;
+    const float alpha = Clamp(chrono::duration<float>(chrono::steady_clock::now() - latest.time).count() / tickLength, 0.0f, 1.0f);
+    if (previous.agentsGeneration != latest.agentsGeneration || previous.x.size() != latest.x.size())
     {
-    case MOUNTAIN:
-        color = DARKGRAY;
-        break;
-
-    case MUD:
-        color = BROWN;
-        break;
+        x = latest.x;
+        y = latest.y;
+        return;
+    }
 
-    case WATER:
-        color = BLUE;
-        color.b = 180;
-        break;
+    x.resize(latest.x.size());
+    y.resize(latest.y.size());
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        x[i] = Lerp(previous.x[i], latest.x[i], alpha);
+        y[i] = Lerp(previous.y[i], latest.y[i], alpha);
+    }
+}
 
-    case GRASS:
-        color = GREEN;
-        color.g = 180;
-        break;
+// Tiles within radius of center that painting type would actually change
+vector<MapEdit> BrushEdits(const Map& map, Cell center, int radius, TileType type)
+{
+    vector<MapEdit> edits;
+    for (int row = center.row - radius; row <= center.row + radius; row++)
+    {
+        for (int col = center.col - radius; col <= center.col + radius; col++)
+        {
+            const Cell cell{ col, row };
+            if (InBounds(cell) && Euclidean(cell, center) <= radius + 0.5f && map[row][col] != type)
+                edits.push_back({ cell, type });
+        }
     }
-    DrawTile(cell, color);
+    return edits;
 }
 
-void DrawTile(Cell cell, Map map)
+void DrawSimulationStats(const Snapshot& snapshot)
 {
-    DrawTile(cell, (TileType)map[cell.row][cell.col]);
+    ImGui::Begin("Frame time");
+    ImGui::Separator();
+    ImGui::Text("Simulation thread, %i Hz (tick %llu)", SIMULATION_HZ, (unsigned long long)snapshot.tick);
+    ImGui::Text("%-12s %8.3f %8.3f %8.3f", "Tick", snapshot.tickTimes.Min(), snapshot.tickTimes.Average(), snapshot.tickTimes.Percentile(0.99f));
+    ImGui::Text("%-12s %8.3f %8.3f %8.3f", "Pathfinding", snapshot.pathTimes.Min(), snapshot.pathTimes.Average(), snapshot.pathTimes.Percentile(0.99f));
+    ImGui::Text("%-12s %8.3f %8.3f %8.3f", "Agents", snapshot.crowdTimes.Min(), snapshot.crowdTimes.Average(), snapshot.crowdTimes.Percentile(0.99f));
+    if (snapshot.jobsRunning > 0)
+        ImGui::Text("%zu background job%s running", snapshot.jobsRunning, snapshot.jobsRunning == 1 ? "" : "s");
+    ImGui::End();
 }
 
 // Late task 1:
@@ -262,8 +2221,28 @@ struct Tile
     float h;
 };
 
-int main(void)
+int main(int argc, char** argv)
 {
+    // Sunshine --replay queries.bin [config ...]
+    if (argc >= 3 && strcmp(argv[1], "--replay") == 0)
+        return Replay(argv[2], vector<string>(argv + 3, argv + argc));
+
+    // Sunshine --mapf map.map scenario.scen [scenario.scen ...]
+    if (argc >= 4 && strcmp(argv[1], "--mapf") == 0)
+        return RunMapfBenchmark(argv[2], vector<string>(argv + 3, argv + argc));
+
+    // Sunshine --distance-field map.map
+    if (argc >= 3 && strcmp(argv[1], "--distance-field") == 0)
+        return RunDistanceFieldBenchmark(argv[2]);
+
+    // Sunshine --wavefront map.map [queries]
+    if (argc >= 3 && strcmp(argv[1], "--wavefront") == 0)
+        return RunWavefrontBenchmark(argv[2], argc >= 4 ? max(1, atoi(argv[3])) : 200);
+
+    // Sunshine --crowd [agents] [ticks]
+    if (argc >= 2 && strcmp(argv[1], "--crowd") == 0)
+        return RunCrowdBenchmark(argc >= 3 ? max(1, atoi(argv[2])) : 20000, argc >= 4 ? max(1, atoi(argv[3])) : 300);
+
     Map map
     {
         array<size_t, TILE_COUNT>{ 0, 0, 4, 0, 0, 0, 0, 0, 0, 0 },
@@ -284,70 +2263,317 @@ int main(void)
     float dist2 = Euclidean(start, goal);
 
     bool manhattan = true;
-    vector<Cell> path = FindPath(start, goal, map, manhattan);
+    bool useCpd = false;
+    bool useSubgoals = false;
+    int shape = GRID_PATH;
+    bool smooth = false;
+    int agentSize = 1;
+    int profile = STANDARD_PROFILE;
+    float weight = 1.0f;
+    bool anytime = false;
+    int target = 0;
+    const char* targetNames[] = { "Goal tile", "Nearest air", "Nearest grass", "Nearest water", "Nearest mud" };
+    const char* profileNames[PROFILE_COUNT];
+    for (int i = 0; i < PROFILE_COUNT; i++)
+        profileNames[i] = MovementProfiles()[i].name;
+    const char* shapeNames[] = { "Grid steps", "Any-angle (Theta*)", "Any-angle (Lazy Theta*)" };
+    SearchProfiler profiler;
+    size_t queriesSeen = 0;
+    int traceStep = 0;
+    bool heatmap = true;
+
+    // The world belongs to the simulation thread once it starts, so set it up (and run the first query) beforehand
+    Simulation simulation;
+    World& initial = simulation.world;
+    initial.map = make_shared<Map>(map);
+    initial.mapVersion = MapVersion(map);
+    for (int profile = 0; profile < PROFILE_COUNT; profile++)
+        initial.profiles[profile].Build(map, initial.mapVersion, profile);
+    initial.profiles[STANDARD_PROFILE].Subgoals(1);
+
+    // Reuse a saved CPD if it was built for this map
+    if (!LoadCompressedPathDatabase(initial.cpd, "sunshine.cpd") || initial.cpd.mapVersion != initial.mapVersion)
+        initial.cpd = {};
+
+    initial.request = { start, goal, manhattan, useCpd, useSubgoals, shape, smooth, agentSize, profile, weight, anytime, target - 1 };
+    RunPathRequest(initial);
+    simulation.Start();
 
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Sunshine");
     rlImGuiSetup(true);
     SetTargetFPS(60);
 
+    int spawnCount = 1000;
+    int groupSize = 20;
+    vector<float> agentX, agentY;
+    FrameProfiler frames;
+
+    Camera2D camera = FitCamera();
+    TerrainCache terrain;
+    terrain.Load();
+
+    // Label tiles with the scores the last search actually ended up with
+    ScoreLabels labels;
+    labels.Load();
+
+    // Terrain painting
+    bool painting = false;
+    int brushType = MOUNTAIN;
+    int brushRadius = 0;
+    uint64_t terrainVersion = 0;
+    {
+        // The world is the simulation thread's now, so go by the snapshot Start published
+        shared_ptr<const Snapshot> previous, first;
+        simulation.Latest(previous, first);
+        terrainVersion = first->mapVersion;
+    }
+
     while (!WindowShouldClose())
     {
-        // TODO (bonus) write code to move an object along the path using interpolation
+        frames.BeginFrame();
+        shared_ptr<const Snapshot> previous, snapshot;
+        simulation.Latest(previous, snapshot);
+        const SearchTrace& trace = *snapshot->trace;
+        {
+            // DONE (bonus): move objects along the path using interpolation
+            ScopedPhase phase(frames, PHASE_SIMULATION);
+            InterpolateAgents(*previous, *snapshot, agentX, agentY);
+            if (snapshot->queries != queriesSeen)
+            {
+                queriesSeen = snapshot->queries;
+                profiler.Record(snapshot->stats);
+                labels.Rebuild(trace);
+                traceStep = (int)trace.Count();
+            }
+        }
+
+        {
+            // Redraw the tiles the simulation changed, or everything if we missed a snapshot in between
+            ScopedPhase phase(frames, PHASE_TERRAIN);
+            if (snapshot->mapVersion != terrainVersion)
+            {
+                if (snapshot->baseVersion == terrainVersion)
+                {
+                    for (const Cell& cell : snapshot->changes)
+                        terrain.MarkDirty(cell);
+                }
+                else
+                {
+                    terrain.MarkAllDirty();
+                }
+                terrainVersion = snapshot->mapVersion;
+            }
+            terrain.Update(*snapshot->map);
+        }
+        {
+            ScopedPhase phase(frames, PHASE_LABELS);
+            labels.Update();
+        }
+        PanZoom(camera);
+        const TileRect visible = VisibleTiles(camera);
 
         BeginDrawing();
         ClearBackground(RAYWHITE);
+        BeginMode2D(camera);
+        {
+            ScopedPhase phase(frames, PHASE_TERRAIN);
+            terrain.Draw();
+        }
 
-        for (int row = 0; row < TILE_COUNT; row++)
+        // Late task 2:  DONE
+        // Upgrade this by switching between manhattan and euclidean if you have yet to hand in lab exercise 4
+        // Also consider building a static grid representation where each tile stores its neighbours
         {
-            for (int col = 0; col < TILE_COUNT; col++)
-            {
-                // We know g score is always 1 when using manhattan distance so just use that for g
-                Cell cell{ col, row };
-                float g = 1.0f;
-                float h = Manhattan(cell, goal);
-
-                // Late task 2:  DONE
-                // Upgrade this by switching between manhattan and euclidean if you have yet to hand in lab exercise 4
-                // Also consider building a static grid representation where each tile stores its neighbours
-                DrawTile(cell, map);
-                Vector2 texPos = TileCenter(cell);
-                DrawText(TextFormat("F: %f", g + h), texPos.x, texPos.y, 10, MAROON);
-            }
+            ScopedPhase phase(frames, PHASE_LABELS);
+            labels.Draw(camera);
         }
 
         Vector2 cursor = GetMousePosition();
-        Cell cursorTile = ScreenToTile(cursor);
+        Cell cursorTile = ScreenToTile(cursor, camera);
+        if (painting && InBounds(cursorTile) && IsMouseButtonDown(MOUSE_BUTTON_LEFT) && !ImGui::GetIO().WantCaptureMouse)
+        {
+            vector<MapEdit> edits = BrushEdits(*snapshot->map, cursorTile, brushRadius, (TileType)brushType);
+            if (!edits.empty())
+                simulation.Post([edits](World& world) { ApplyEdits(world, edits); });
+        }
+        {
+            ScopedPhase phase(frames, PHASE_OVERLAYS);
+            if (heatmap)
+                DrawTraceHeatmap(trace, traceStep, visible);
 
-        for (const Cell& cell : path)
-            DrawTile(cell, RED);
+            DrawTiles(*snapshot->path, RED, visible);
+            DrawPathLine(*snapshot->path, MAROON);
 
-        DrawTile(cursorTile, GRAY);
-        DrawTile(start, DARKBLUE);
-        DrawTile(goal, SKYBLUE);
+            if (InBounds(cursorTile))
+                DrawTile(cursorTile, GRAY);
+            DrawTile(start, DARKBLUE);
+            // Nearest-tile queries ignore the goal, so mark the tile the path found instead
+            if (snapshot->nearest < 0)
+                DrawTile(goal, SKYBLUE);
+            else if (!snapshot->path->empty())
+                DrawTile(snapshot->path->back(), SKYBLUE);
+            DrawAgents(agentX, agentY, visible, PURPLE);
+        }
+        EndMode2D();
 
         // We can see quantization & localization in-action if we convert the cursor to tile coordinates
         //DrawText(TextFormat("row %i, col %i", cursorTile.row, cursorTile.col), cursor.x, cursor.y, 20, DARKGRAY);
 
+        frames.Switch(PHASE_UI);
         rlImGuiBegin();
 
         // DONE: 
         // Late task 3: Upgrade GUI to recompute the path when start and end change
         
         
-        if (ImGui::Button("Find path") 
-            || (ImGui::SliderInt2("Start", &start.col, 0, TILE_COUNT - 1)) 
-                || (ImGui::SliderInt2("Goal", &goal.col, 0, TILE_COUNT - 1))
-                    || (ImGui::Checkbox("Toggle Manhattan/ Euclidean", &manhattan))
-        )        
+        // Every widget has to be drawn each frame, so don't let an earlier one short-circuit the rest
+        bool changed = ImGui::Button("Find path");
+        changed |= ImGui::SliderInt2("Start", &start.col, 0, TILE_COUNT - 1);
+        changed |= ImGui::SliderInt2("Goal", &goal.col, 0, TILE_COUNT - 1);
+        changed |= ImGui::Checkbox("Toggle Manhattan/ Euclidean", &manhattan);
+        changed |= ImGui::Checkbox("Use CPD", &useCpd);
+        changed |= ImGui::Checkbox("Use subgoal graph (passability only)", &useSubgoals);
+        changed |= ImGui::Combo("Path shape", &shape, shapeNames, 3);
+        changed |= ImGui::Checkbox("Smooth path", &smooth);
+        changed |= ImGui::SliderInt("Agent size", &agentSize, 1, MAX_AGENT_SIZE);
+        changed |= ImGui::Combo("Movement profile", &profile, profileNames, PROFILE_COUNT);
+        changed |= ImGui::SliderFloat("Heuristic weight", &weight, 1.0f, 5.0f);
+        changed |= ImGui::Checkbox("Anytime (ARA*)", &anytime);
+        changed |= ImGui::Combo("Target", &target, targetNames, 5);
+        if (changed)
         {
-            path = FindPath(start, goal, map, manhattan);
+            const PathRequest request{ start, goal, manhattan, useCpd, useSubgoals, shape, smooth, agentSize, profile, weight, anytime, target - 1 };
+            simulation.Post([request](World& world)
+            {
+                world.request = request;
+                world.requestPending = true;
+            });
         } 
+        ImGui::Text("%zu waypoints, cost %.1f", snapshot->path->size(), snapshot->pathCost);
+        if (snapshot->nearest >= 0)
+        {
+            ImGui::SameLine();
+            if (snapshot->path->empty())
+                ImGui::Text("(%s: none reachable)", targetNames[snapshot->nearest + 1]);
+            else
+                ImGui::Text("(%s at %i, %i)", targetNames[snapshot->nearest + 1], snapshot->path->back().col, snapshot->path->back().row);
+        }
+        if (snapshot->stats.bound > 1.0f || snapshot->improving)
+        {
+            ImGui::SameLine();
+            ImGui::Text("(within %.2fx of optimal%s)", snapshot->stats.bound, snapshot->improving ? ", improving" : "");
+        }
+
+        bool logging = snapshot->logging;
+        if (ImGui::Checkbox("Record queries to queries.bin", &logging))
+        {
+            simulation.Post([logging](World& world)
+            {
+                if (logging)
+                    world.log.Open("queries.bin");
+                else
+                    world.log.Close();
+            });
+        }
+
+        if (ImGui::Button("Build CPD"))
+        {
+            simulation.Post([manhattan](World& world)
+            {
+                BuildCpd(world, manhattan);
+            });
+        }
+        if (snapshot->hasCpd)
+        {
+            ImGui::SameLine();
+            ImGui::Text("CPD (%s): %zu runs, %zu bytes", snapshot->cpdManhattan ? "Manhattan" : "Euclidean", snapshot->cpdRuns, snapshot->cpdBytes);
+            if (useCpd && snapshot->cpdManhattan != manhattan)
+                ImGui::TextDisabled("Built for the other heuristic, falling back to A*");
+        }
+        ImGui::Text("%zu subgoals", snapshot->subgoals);
+        if (useSubgoals)
+            ImGui::TextDisabled("Subgoal paths are shortest around tiles the profile can't enter, ignoring terrain costs");
+
+        ImGui::Separator();
+        ImGui::Checkbox("Paint terrain (left mouse)", &painting);
+        const char* tileNames[] = { "Air", "Grass", "Water", "Mud", "Mountain" };
+        ImGui::Combo("Brush", &brushType, tileNames, COUNT);
+        ImGui::SliderInt("Brush radius", &brushRadius, 0, 8);
+
+        ImGui::Separator();
+        ImGui::SliderInt("Agents to spawn", &spawnCount, 1, 20000);
+        if (ImGui::Button("Spawn on path"))
+        {
+            simulation.Post([spawnCount](World& world)
+            {
+                SpawnAgents(world.agents, *world.path, spawnCount);
+                world.agentsGeneration++;
+            });
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Clear agents"))
+        {
+            simulation.Post([](World& world)
+            {
+                world.agents.Clear();
+                world.agentsGeneration++;
+            });
+        }
+        ImGui::SameLine();
+        ImGui::Text("%zu agents", agentX.size());
+        bool steering = snapshot->steering;
+        if (ImGui::Checkbox("Crowd steering", &steering))
+        {
+            simulation.Post([steering](World& world)
+            {
+                world.steering = steering;
+            });
+        }
+        ImGui::SliderInt("Group size", &groupSize, 2, TILE_COUNT * TILE_COUNT / 2);
+        if (ImGui::Button("Cooperative group (WHCA*)"))
+        {
+            simulation.Post([groupSize](World& world)
+            {
+                SpawnCooperativeGroup(world, groupSize);
+            });
+        }
+        const CooperativeStats& cooperative = snapshot->cooperative;
+        if (cooperative.windows > 0)
+        {
+            ImGui::Text("%zu windows, %zu expanded, %zu stalled, %.3f ms%s", cooperative.windows, cooperative.expanded,
+                cooperative.failedSearches, cooperative.milliseconds, cooperative.allArrived ? "" : " (not all arrived)");
+        }
+        if (ImGui::Button("Optimal group (CBS)"))
+        {
+            simulation.Post([groupSize](World& world)
+            {
+                SpawnOptimalGroup(world, groupSize);
+            });
+        }
+        const CbsStats& cbs = snapshot->cbs;
+        if (cbs.expandedNodes > 0)
+        {
+            if (cbs.solved)
+                ImGui::Text("Cost %.1f, %zu nodes, %zu bypasses, %zu searches, %.3f ms", cbs.cost, cbs.expandedNodes, cbs.bypasses, cbs.lowLevelSearches, cbs.milliseconds);
+            else
+                ImGui::TextDisabled("No solution within %.0f ms (%zu nodes)", CBS_UI_TIME_LIMIT, cbs.expandedNodes);
+        }
+
+        DrawProfiler(profiler, manhattan);
+        DrawTraceControls(trace, traceStep, heatmap);
+        DrawFrameProfiler(frames);
+        DrawSimulationStats(*snapshot);
         
         rlImGuiEnd();
 
+        frames.Switch(PHASE_PRESENT);
         EndDrawing();
+        frames.EndFrame();
     }
 
+    simulation.Stop();
+    labels.Unload();
+    terrain.Unload();
     rlImGuiShutdown();
     CloseWindow();
     return 0;
@@ -0,0 +1,79 @@
+#include "ProfileCache.h"
+#include "TestMaps.h"
+
+// Whether a path runs from start to goal with every segment walkable under the profile & agent size
+template<typename EnterCost>
+bool Walkable(const vector<Cell>& path, Cell start, Cell goal, EnterCost enterCost)
+{
+    if (!(path.front() == start) || !(path.back() == goal)) return false;
+    for (size_t i = 1; i < path.size(); i++)
+    {
+        if (LineCost(path[i - 1], path[i], enterCost) == IMPASSABLE) return false;
+    }
+    return true;
+}
+
+// Theta*, Lazy Theta* & smoothed A* paths only cross tiles the profile & agent can enter, & cost no more than the A* path
+// they stand in for. Covers every profile, so boats smoothing along a coast don't cut across land.
+int main()
+{
+    mt19937 random(43);
+    int total = 0;
+    int invalidPaths = 0;
+    int costlierPaths = 0;
+    for (int trial = 0; trial < 40; trial++)
+    {
+        const Map map = RandomMap(random, 15);
+        const int id = trial % PROFILE_COUNT;
+        ProfileCache profile;
+        profile.Build(map, MapVersion(map), id);
+
+        for (int query = 0; query < 25; query++, total++)
+        {
+            const Cell start = RandomCell(random);
+            const Cell goal = RandomCell(random);
+            const int size = 1 + query % 2;
+            const auto enterCost = ProfileEnterCost(profile, size);
+            const vector<Cell> grid = FindPath(start, goal, profile, false, nullptr, nullptr, size);
+            const vector<Cell> paths[] = {
+                FindAnyAnglePath(start, goal, profile, false, nullptr, size),
+                FindAnyAnglePath(start, goal, profile, true, nullptr, size),
+                grid.empty() ? grid : SmoothPath(grid, enterCost),
+            };
+            for (const vector<Cell>& path : paths)
+            {
+                if (path.empty() || grid.empty())
+                {
+                    invalidPaths += path.empty() != grid.empty();
+                    continue;
+                }
+                invalidPaths += !Walkable(path, start, goal, enterCost);
+                costlierPaths += PathCost(path, enterCost, false) > PathCost(grid, enterCost, false) + 1e-3f;
+            }
+        }
+    }
+
+    // A wall with a one tile gap: single tiles get through, agents two tiles wide don't
+    Map walled;
+    for (auto& row : walled)
+        row.fill(AIR);
+    for (int row = 0; row < TILE_COUNT; row++)
+        walled[row][TILE_COUNT / 2] = row == TILE_COUNT / 2 ? AIR : MOUNTAIN;
+    ProfileCache profile;
+    profile.Build(walled, MapVersion(walled), STANDARD_PROFILE);
+    const Cell start{ 1, 1 };
+    const Cell goal{ TILE_COUNT - 2, TILE_COUNT - 2 };
+    int gapMismatches = 0;
+    for (const bool lazy : { false, true })
+    {
+        gapMismatches += FindAnyAnglePath(start, goal, profile, lazy, nullptr, 1).empty();
+        gapMismatches += !FindAnyAnglePath(start, goal, profile, lazy, nullptr, 2).empty();
+    }
+    gapMismatches += !FindPath(start, goal, profile, false, nullptr, nullptr, 2).empty();
+
+    int failed = 0;
+    failed += Report("Any-angle paths are walkable", invalidPaths, total * 3);
+    failed += Report("Any-angle paths cost no more than A*", costlierPaths, total * 3);
+    failed += Report("Wide agents don't fit through a gap", gapMismatches, 5);
+    return failed;
+}
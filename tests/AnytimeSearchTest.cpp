@@ -0,0 +1,55 @@
+#include "AnytimeSearch.h"
+#include "TestMaps.h"
+
+// Every ARA* pass costs no more than its bound times the A* cost, & the last one, at bound 1, costs what A* does. Passes
+// that leave work for the next one are rare on small maps, hence the many trials.
+int main()
+{
+    mt19937 random(46);
+    int total = 0;
+    int boundMismatches = 0;
+    int finalMismatches = 0;
+    AnytimeSearch search;
+    for (int trial = 0; trial < 400; trial++)
+    {
+        const Map map = RandomMap(random, 15);
+        const int id = trial % PROFILE_COUNT;
+        const bool manhattan = trial / PROFILE_COUNT % 2 == 1;
+        ProfileCache profile;
+        profile.Build(map, MapVersion(map), id);
+
+        for (int query = 0; query < 25; query++, total++)
+        {
+            const Cell start = RandomCell(random);
+            const Cell goal = RandomCell(random);
+            const int size = 1 + query % 2;
+            const auto enterCost = ProfileEnterCost(profile, size);
+            const vector<Cell> expected = FindPath(start, goal, profile, manhattan, nullptr, nullptr, size);
+            const float expectedCost = expected.empty() ? FLT_MAX : PathCost(expected, enterCost, manhattan);
+
+            search.Reset(start, goal, profile, manhattan, size, 1.0f + query % 4);
+            vector<Cell> path;
+            vector<Cell> last;
+            SearchStats stats;
+            float bound = FLT_MAX;
+            while (search.Running())
+            {
+                if (!search.Improve(ANYTIME_TIME_LIMIT, path, stats) || path.empty()) continue;
+                const float cost = PathCost(path, enterCost, manhattan);
+                boundMismatches += stats.bound > bound || cost > stats.bound * expectedCost * (1.0f + 1e-4f);
+                bound = stats.bound;
+                last = path;
+            }
+
+            if (last.empty() || expected.empty())
+                finalMismatches += last.empty() != expected.empty();
+            else
+                finalMismatches += bound != 1.0f || !(last.back() == goal) || !SameCost(PathCost(last, enterCost, manhattan), expectedCost);
+        }
+    }
+
+    int failed = 0;
+    failed += Report("Anytime passes stay within their bound", boundMismatches, total);
+    failed += Report("Anytime search ends at the A* cost", finalMismatches, total);
+    return failed;
+}
@@ -0,0 +1,56 @@
+#include "BoundedSearch.h"
+#include "TestMaps.h"
+
+// Bounded searches with room for the whole map cost what FindPath does; squeezed into a few hundred bytes they either
+// still find an optimal path or hand back a partial one from the start
+int main()
+{
+    mt19937 random(50);
+    BoundedSearchMemory ample(1 << 22);
+    BoundedSearchMemory tiny(512);
+    int total = 0;
+    int ampleMismatches = 0;
+    int tinyMismatches = 0;
+    int partial = 0;
+    for (int trial = 0; trial < 40; trial++)
+    {
+        const Map map = RandomMap(random, 15);
+        const int id = trial % PROFILE_COUNT;
+        const bool manhattan = trial / PROFILE_COUNT % 2 == 1;
+        ProfileCache profile;
+        profile.Build(map, MapVersion(map), id);
+
+        for (int query = 0; query < 25; query++, total++)
+        {
+            const Cell start = RandomCell(random);
+            const Cell goal = RandomCell(random);
+            const int size = 1 + query % 2;
+            const auto enterCost = ProfileEnterCost(profile, size);
+            const vector<Cell> expected = FindPath(start, goal, profile, manhattan, nullptr, nullptr, size);
+            const float expectedCost = expected.empty() ? FLT_MAX : PathCost(expected, enterCost, manhattan);
+
+            SearchStats stats;
+            const vector<Cell> path = FindBoundedPath(start, goal, profile, manhattan, ample, &stats, size);
+            if (path.empty() || expected.empty())
+                ampleMismatches += path.empty() != expected.empty();
+            else
+                ampleMismatches += stats.partial || !(path.back() == goal) || !SameCost(PathCost(path, enterCost, manhattan), expectedCost);
+
+            const vector<Cell> squeezed = FindBoundedPath(start, goal, profile, manhattan, tiny, &stats, size);
+            partial += stats.partial;
+            // Unreachable goals it may give up on before finding out
+            if (squeezed.empty() || expected.empty())
+                tinyMismatches += squeezed.empty() != expected.empty() && !stats.partial;
+            else if (stats.partial)
+                tinyMismatches += !(squeezed.front() == start) || PathCost(squeezed, enterCost, manhattan) == IMPASSABLE;
+            else
+                tinyMismatches += !(squeezed.back() == goal) || !SameCost(PathCost(squeezed, enterCost, manhattan), expectedCost);
+        }
+    }
+
+    printf("%i/%i searches in %zu bytes gave up with a partial path\n", partial, total, tiny.Bytes());
+    int failed = 0;
+    failed += Report("Bounded search with ample memory is A*", ampleMismatches, total);
+    failed += Report("Bounded search out of memory", tinyMismatches, total);
+    return failed;
+}
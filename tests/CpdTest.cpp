@@ -0,0 +1,88 @@
+#include "Cpd.h"
+#include "Search.h"
+#include "TestMaps.h"
+#include <fstream>
+#include <iterator>
+#include <cstring>
+
+// Writes bytes to path & loads it back as a CPD
+bool LoadBytes(const vector<char>& bytes, CompressedPathDatabase& cpd)
+{
+    {
+        ofstream file("cpd_test.cpd", ios::binary | ios::trunc);
+        file.write(bytes.data(), bytes.size());
+    }
+    return LoadCompressedPathDatabase(cpd, "cpd_test.cpd");
+}
+
+// Overwrites the u32 at offset
+void Poke(vector<char>& bytes, size_t offset, uint32_t value)
+{
+    memcpy(bytes.data() + offset, &value, sizeof(value));
+}
+
+// CPD paths cost the same as A*'s, before & after a save/load round trip, & corrupt files are rejected outright
+int main()
+{
+    mt19937 random(29);
+    int total = 0;
+    int costMismatches = 0;
+    int reloadMismatches = 0;
+    for (int trial = 0; trial < 20; trial++)
+    {
+        const Map map = RandomMap(random, 20);
+        const bool manhattan = trial % 2 == 1;
+        const CompressedPathDatabase cpd = BuildCompressedPathDatabase(map, MapVersion(map), manhattan);
+
+        CompressedPathDatabase loaded;
+        const bool reloaded = SaveCompressedPathDatabase(cpd, "cpd_test.cpd") && LoadCompressedPathDatabase(loaded, "cpd_test.cpd");
+        for (int query = 0; query < 50; query++, total++)
+        {
+            const Cell start = RandomCell(random);
+            const Cell goal = RandomCell(random);
+            const vector<Cell> path = FindPath(start, goal, cpd);
+            const float expected = PathCost(FindPath(start, goal, map, manhattan), map, manhattan);
+            costMismatches += path.empty() || !(path.front() == start) || !(path.back() == goal) ||
+                !SameCost(PathCost(path, map, manhattan), expected);
+
+            const vector<Cell> reloadedPath = reloaded ? FindPath(start, goal, loaded) : vector<Cell>{};
+            reloadMismatches += reloadedPath.size() != path.size() || !equal(path.begin(), path.end(), reloadedPath.begin());
+        }
+    }
+
+    // Header is "SCPD", u32 TILE_COUNT, u64 version, u8 manhattan & u32 run count, followed by the rows then the runs
+    const Map map = RandomMap(random, 20);
+    const CompressedPathDatabase cpd = BuildCompressedPathDatabase(map, MapVersion(map), true);
+    SaveCompressedPathDatabase(cpd, "cpd_test.cpd");
+    ifstream saved("cpd_test.cpd", ios::binary);
+    const vector<char> bytes{ istreambuf_iterator<char>(saved), istreambuf_iterator<char>() };
+    saved.close();
+    const size_t runCountOffset = 17;
+    const size_t rowsOffset = 21;
+    const size_t runsOffset = rowsOffset + cpd.rows.size() * sizeof(uint32_t);
+
+    vector<vector<char>> corrupt(7, bytes);
+    Poke(corrupt[0], runCountOffset, UINT32_MAX);                       // Absurd run count
+    corrupt[1].resize(bytes.size() - 3);                                // Cut short
+    Poke(corrupt[2], rowsOffset + sizeof(uint32_t), cpd.rows[0]);       // First row empty
+    Poke(corrupt[3], runsOffset, (1u << 4) | (cpd.runs[0] & 0xF));      // First row skips target 0
+    Poke(corrupt[4], runsOffset, cpd.runs[0] | 0xF);                    // Move that isn't one
+    Poke(corrupt[5], rowsOffset, 1);                                    // Rows don't start at the first run
+    Poke(corrupt[6], runsOffset + sizeof(uint32_t), cpd.runs[1] & 0xF); // Targets out of order
+    int corruptAccepted = 0;
+    for (const vector<char>& file : corrupt)
+    {
+        CompressedPathDatabase loaded;
+        loaded.mapVersion = 1;
+        corruptAccepted += LoadBytes(file, loaded) || !loaded.Empty() || loaded.mapVersion != 0;
+    }
+    CompressedPathDatabase intact;
+    corruptAccepted += !LoadBytes(bytes, intact) || intact.rows != cpd.rows || intact.runs != cpd.runs;
+    remove("cpd_test.cpd");
+
+    int failed = 0;
+    failed += Report("CPD path cost matches A*", costMismatches, total);
+    failed += Report("CPD paths survive save & load", reloadMismatches, total);
+    failed += Report("Corrupt CPD files are rejected", corruptAccepted, (int)corrupt.size() + 1);
+    return failed;
+}
@@ -0,0 +1,73 @@
+#include "DistanceField.h"
+#include "Search.h"
+#include "TestMaps.h"
+
+// Random grid of any size & every kind of terrain, for fields bigger than a Map
+TileGrid RandomGrid(mt19937& random, int width, int height)
+{
+    TileGrid grid;
+    grid.width = width;
+    grid.height = height;
+    grid.tiles.resize(size_t(width) * height);
+    for (uint8_t& tile : grid.tiles)
+        tile = random() % COUNT;
+    return grid;
+}
+
+bool SameField(const vector<float>& a, const vector<float>& b)
+{
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        if (a[i] == FLT_MAX || b[i] == FLT_MAX ? a[i] != b[i] : !SameCost(a[i], b[i])) return false;
+    }
+    return a.size() == b.size();
+}
+
+// Delta-stepping over a pool of helpers gives the same field as Dijkstra, & Dijkstra's cost from any tile to the goal
+// is what A* finds for that pair
+int main()
+{
+    mt19937 random(48);
+    WorkerPool pool;
+    pool.Start(3);
+    int fieldTotal = 0;
+    int queryTotal = 0;
+    int fieldMismatches = 0;
+    int costMismatches = 0;
+
+    vector<TileGrid> grids;
+    for (int trial = 0; trial < 20; trial++)
+        grids.push_back(TileGrid(RandomMap(random, 15 + trial % 4 * 10)));
+    grids.push_back(RandomGrid(random, 300, 200));
+    grids.push_back(RandomGrid(random, 1, 90));
+    for (const TileGrid& grid : grids)
+    {
+        for (int query = 0; query < 10; query++, fieldTotal++)
+        {
+            const Cell goal = grid.CellOf(random() % grid.tiles.size());
+            const bool manhattan = query % 2 == 1;
+            fieldMismatches += !SameField(DistancesToGoal(grid, goal, manhattan, pool), DistancesToGoal(grid, goal, manhattan));
+        }
+    }
+
+    for (int trial = 0; trial < 40; trial++)
+    {
+        const Map map = RandomMap(random, 15);
+        for (int query = 0; query < 25; query++, queryTotal++)
+        {
+            const Cell start = RandomCell(random);
+            const Cell goal = RandomCell(random);
+            const bool manhattan = query % 2 == 1;
+            const vector<float> distances = DistancesToGoal(map, goal, manhattan);
+            const vector<Cell> path = FindPath(start, goal, map, manhattan);
+            costMismatches += path.empty() ? distances[Index(start)] != FLT_MAX :
+                !SameCost(PathCost(path, map, manhattan), distances[Index(start)]);
+        }
+    }
+    pool.Stop();
+
+    int failed = 0;
+    failed += Report("Delta-stepping matches Dijkstra", fieldMismatches, fieldTotal);
+    failed += Report("Dijkstra field matches A* cost", costMismatches, queryTotal);
+    return failed;
+}
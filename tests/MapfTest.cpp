@@ -0,0 +1,193 @@
+#include "Mapf.h"
+#include "SubgoalGraph.h"
+#include "TestMaps.h"
+#include <queue>
+
+// Where an agent is at time, staying on the last tile of its path once the path ends
+Cell At(const vector<Cell>& path, size_t time)
+{
+    return path[min(time, path.size() - 1)];
+}
+
+// Pairs of agents that share a tile, swap tiles or cross diagonally at any time step
+int Collisions(const vector<vector<Cell>>& paths)
+{
+    size_t length = 0;
+    for (const vector<Cell>& path : paths)
+        length = max(length, path.size());
+
+    int collisions = 0;
+    for (size_t a = 0; a < paths.size(); a++)
+    {
+        for (size_t b = a + 1; b < paths.size(); b++)
+        {
+            for (size_t time = 0; time < length; time++)
+            {
+                const Cell a0 = At(paths[a], time), a1 = At(paths[a], time + 1);
+                const Cell b0 = At(paths[b], time), b1 = At(paths[b], time + 1);
+                const bool crossing = a0.col != a1.col && a0.row != a1.row &&
+                    ((b0 == Cell{ a0.col, a1.row } && b1 == Cell{ a1.col, a0.row }) ||
+                     (b0 == Cell{ a1.col, a0.row } && b1 == Cell{ a0.col, a1.row }));
+                collisions += a0 == b0 || (a0 == b1 && a1 == b0) || crossing;
+            }
+        }
+    }
+    return collisions;
+}
+
+// Whether every path starts on its agent's start & only ever waits or steps to a neighbouring tile
+bool Connected(const vector<vector<Cell>>& paths, const vector<Cell>& starts)
+{
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        if (paths[i].empty() || !(paths[i].front() == starts[i])) return false;
+        for (size_t step = 1; step < paths[i].size(); step++)
+        {
+            if (abs(paths[i][step].col - paths[i][step - 1].col) > 1 || abs(paths[i][step].row - paths[i][step - 1].row) > 1)
+                return false;
+        }
+    }
+    return true;
+}
+
+// Cost of one agent's path as CBS counts it: waiting costs 1, moving costs StepCost, & a step that isn't allowed fails
+float MapfCost(const vector<Cell>& path, const Map& map, bool manhattan)
+{
+    float cost = 0.0f;
+    for (size_t step = 1; step < path.size(); step++)
+    {
+        const Cell move{ path[step].col - path[step - 1].col, path[step].row - path[step - 1].row };
+        if (move == Cell{ 0, 0 })
+            cost += 1.0f;
+        else if (abs(move.col) <= 1 && abs(move.row) <= 1 && CanStep(map, path[step - 1], move))
+            cost += StepCost(path[step - 1], path[step], map, manhattan);
+        else
+            return FLT_MAX;
+    }
+    return cost;
+}
+
+// Cheapest way from start to goal alone, by Dijkstra over the moves CBS allows
+float AloneCost(Cell start, Cell goal, const Map& map, bool manhattan)
+{
+    vector<float> distances(TILE_COUNT * TILE_COUNT, FLT_MAX);
+    using Entry = pair<float, size_t>;
+    priority_queue<Entry, vector<Entry>, greater<Entry>> open;
+    distances[Index(start)] = 0.0f;
+    open.push({ 0.0f, Index(start) });
+    while (!open.empty())
+    {
+        const auto [distance, index] = open.top();
+        open.pop();
+        if (distance > distances[index]) continue;
+
+        const Cell cell{ int(index % TILE_COUNT), int(index / TILE_COUNT) };
+        for (const Cell& move : MOVES)
+        {
+            if (!CanStep(map, cell, move)) continue;
+            const Cell neighbour{ cell.col + move.col, cell.row + move.row };
+            const float candidate = distance + StepCost(cell, neighbour, map, manhattan);
+            if (candidate < distances[Index(neighbour)])
+            {
+                distances[Index(neighbour)] = candidate;
+                open.push({ candidate, Index(neighbour) });
+            }
+        }
+    }
+    return distances[Index(goal)];
+}
+
+// Distinct random tiles that aren't mountains
+vector<Cell> RandomTiles(mt19937& random, const Map& map, int count)
+{
+    vector<Cell> tiles;
+    while ((int)tiles.size() < count)
+    {
+        const Cell cell = RandomCell(random);
+        if (map[cell.row][cell.col] != MOUNTAIN && find(tiles.begin(), tiles.end(), cell) == tiles.end())
+            tiles.push_back(cell);
+    }
+    return tiles;
+}
+
+// Groups planned together never collide & every agent ends on its goal whenever the planner says they all arrived.
+// Solved CBS groups cost what their paths do, no less than each agent would alone, & exactly that for a lone agent.
+// FindConflicts spots the same collisions as a plain check, on random walks that bump into each other.
+int main()
+{
+    mt19937 random(39);
+    int total = 0;
+    int cooperativeCollisions = 0;
+    int cooperativeInvalid = 0;
+    int arrived = 0;
+    int cbsCollisions = 0;
+    int cbsInvalid = 0;
+    int cbsCostMismatches = 0;
+    int solved = 0;
+    int conflictMismatches = 0;
+    for (int trial = 0; trial < 200; trial++, total++)
+    {
+        const Map map = RandomMap(random, 15);
+        const int agents = 2 + trial % 6;
+        const bool manhattan = trial % 2 == 1;
+        const vector<Cell> starts = RandomTiles(random, map, agents);
+        const vector<Cell> goals = RandomTiles(random, map, agents);
+
+        CooperativeStats stats;
+        const vector<vector<Cell>> paths = PlanCooperative(map, starts, goals, manhattan, 64, &stats);
+        cooperativeCollisions += Collisions(paths) > 0;
+        bool onGoals = true;
+        for (int i = 0; i < agents; i++)
+            onGoals = onGoals && paths[i].back() == goals[i];
+        cooperativeInvalid += !Connected(paths, starts) || (stats.allArrived && !onGoals);
+        arrived += stats.allArrived;
+
+        // Mountains are walls to CBS, so some goals can't be reached at all
+        const int cbsAgents = 1 + trial % 5;
+        const vector<Cell> cbsStarts(starts.begin(), starts.begin() + min(agents, cbsAgents));
+        const vector<Cell> cbsGoals(goals.begin(), goals.begin() + min(agents, cbsAgents));
+        CbsStats cbs;
+        const vector<vector<Cell>> cbsPaths = PlanCbs(map, cbsStarts, cbsGoals, manhattan, true, 100.0, &cbs);
+        if (cbs.solved)
+        {
+            solved++;
+            cbsCollisions += Collisions(cbsPaths) > 0 || !FindConflicts(cbsPaths).empty();
+            float cost = 0.0f;
+            float alone = 0.0f;
+            bool valid = Connected(cbsPaths, cbsStarts);
+            for (size_t i = 0; i < cbsPaths.size() && valid; i++)
+            {
+                valid = cbsPaths[i].back() == cbsGoals[i] && MapfCost(cbsPaths[i], map, manhattan) != FLT_MAX;
+                cost += valid ? MapfCost(cbsPaths[i], map, manhattan) : 0.0f;
+                alone += AloneCost(cbsStarts[i], cbsGoals[i], map, manhattan);
+            }
+            cbsInvalid += !valid;
+            cbsCostMismatches += valid && (!SameCost(cost, cbs.cost) || cost < alone - 1e-3f || (cbsPaths.size() == 1 && !SameCost(cost, alone)));
+        }
+
+        // Random walks, some of which are bound to meet
+        vector<vector<Cell>> walks(agents);
+        for (int i = 0; i < agents; i++)
+        {
+            walks[i].push_back(starts[i]);
+            for (int step = 0; step < 12; step++)
+            {
+                const Cell last = walks[i].back();
+                const Cell move = MOVES[random() % MOVES.size()];
+                const Cell next{ last.col + move.col, last.row + move.row };
+                walks[i].push_back(InBounds(next) ? next : last);
+            }
+        }
+        conflictMismatches += FindConflicts(walks).empty() != (Collisions(walks) == 0);
+    }
+
+    printf("%i/%i cooperative groups all arrived, CBS solved %i/%i\n", arrived, total, solved, total);
+    int failed = 0;
+    failed += Report("Cooperative paths never collide", cooperativeCollisions, total);
+    failed += Report("Cooperative paths are walkable", cooperativeInvalid, total);
+    failed += Report("CBS paths never collide", cbsCollisions, solved);
+    failed += Report("CBS paths are walkable", cbsInvalid, solved);
+    failed += Report("CBS cost adds up", cbsCostMismatches, solved);
+    failed += Report("Conflicts found match collisions", conflictMismatches, total);
+    return failed;
+}
@@ -0,0 +1,58 @@
+#include "PathRepair.h"
+#include "Search.h"
+#include "TestMaps.h"
+
+// Whether a repaired path costs what a fresh A* search on the same map does
+bool SameAsFresh(const vector<Cell>& path, Cell start, Cell goal, const Map& map, bool manhattan)
+{
+    const vector<Cell> expected = FindPath(start, goal, map, manhattan);
+    if (path.empty() || expected.empty()) return path.empty() == expected.empty();
+    return path.front() == start && path.back() == goal && SameCost(PathCost(path, map, manhattan), PathCost(expected, map, manhattan));
+}
+
+// LPA* keeps costing what a fresh A* does through rounds of random edits, whether it started from its own search or
+// was seeded from an A* search's nodes
+int main()
+{
+    mt19937 random(38);
+    int total = 0;
+    int mismatches = 0;
+    int seededMismatches = 0;
+    for (int trial = 0; trial < 100; trial++)
+    {
+        Map map = RandomMap(random, 15 + trial % 3 * 10);
+        const Cell start = RandomCell(random);
+        const Cell goal = RandomCell(random);
+        const bool manhattan = trial % 2 == 1;
+
+        PathRepair repair;
+        repair.Reset(start, goal, manhattan);
+        mismatches += !SameAsFresh(repair.ComputePath(map), start, goal, map, manhattan);
+
+        SearchTrace trace;
+        FindPath(start, goal, map, manhattan, nullptr, &trace);
+        PathRepair seeded;
+        seeded.Reset(start, goal, manhattan);
+        seeded.Seed(map, trace.nodes);
+
+        for (int round = 0; round < 10; round++, total++)
+        {
+            vector<Cell> changed;
+            for (int edit = 0; edit < 1 + round % 4; edit++)
+            {
+                const Cell cell = RandomCell(random);
+                map[cell.row][cell.col] = random() % COUNT;
+                changed.push_back(cell);
+            }
+            repair.TilesChanged(map, changed);
+            mismatches += !SameAsFresh(repair.ComputePath(map), start, goal, map, manhattan);
+            seeded.TilesChanged(map, changed);
+            seededMismatches += !SameAsFresh(seeded.ComputePath(map), start, goal, map, manhattan);
+        }
+    }
+
+    int failed = 0;
+    failed += Report("Repaired path matches A*", mismatches, total + 100);
+    failed += Report("Seeded repair matches A*", seededMismatches, total);
+    return failed;
+}
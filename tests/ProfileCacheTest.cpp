@@ -0,0 +1,110 @@
+#include "ProfileCache.h"
+#include "TestMaps.h"
+#include <queue>
+
+// Cheapest way from start to goal by Dijkstra over a profile's terrain costs, FLT_MAX if there isn't one. Agents bigger
+// than a tile also need the clearance, with everything the profile can't enter counting as a mountain.
+float ReferenceCost(Cell start, Cell goal, const Map& map, int profile, bool manhattan, int size)
+{
+    const array<float, COUNT>& costs = MovementProfiles()[profile].costs;
+    Map blocked = map;
+    for (auto& row : blocked)
+    {
+        for (size_t& tile : row)
+            tile = costs[tile] == IMPASSABLE ? MOUNTAIN : tile;
+    }
+    ClearanceMap clearance;
+    clearance.Build(blocked);
+    if ((size > 1 && !clearance.Fits(start, size)) || costs[map[start.row][start.col]] == IMPASSABLE) return FLT_MAX;
+
+    vector<float> distances(TILE_COUNT * TILE_COUNT, FLT_MAX);
+    using Entry = pair<float, size_t>;
+    priority_queue<Entry, vector<Entry>, greater<Entry>> open;
+    distances[Index(start)] = 0.0f;
+    open.push({ 0.0f, Index(start) });
+    while (!open.empty())
+    {
+        const auto [distance, index] = open.top();
+        open.pop();
+        if (distance > distances[index]) continue;
+
+        const Cell cell{ int(index % TILE_COUNT), int(index / TILE_COUNT) };
+        for (const Cell& neighbour : Neighbours(cell))
+        {
+            const float terrain = costs[map[neighbour.row][neighbour.col]];
+            if (terrain == IMPASSABLE || (size > 1 && !clearance.Fits(cell, neighbour, size))) continue;
+            const float candidate = distance + (manhattan ? Manhattan(cell, neighbour) : Euclidean(cell, neighbour)) + terrain;
+            if (candidate < distances[Index(neighbour)])
+            {
+                distances[Index(neighbour)] = candidate;
+                open.push({ candidate, Index(neighbour) });
+            }
+        }
+    }
+    return distances[Index(goal)];
+}
+
+// Per-profile searches cost what a plain Dijkstra over the profile's costs does, caches kept up to date through edits
+// answer like freshly built ones, & a multi-goal search finds the cheapest of its goals
+int main()
+{
+    mt19937 random(45);
+    int total = 0;
+    int costMismatches = 0;
+    int updateMismatches = 0;
+    int multiGoalMismatches = 0;
+    for (int trial = 0; trial < 40; trial++)
+    {
+        Map map = RandomMap(random, 15);
+        const int id = trial % PROFILE_COUNT;
+        const bool manhattan = trial / PROFILE_COUNT % 2 == 1;
+        ProfileCache profile;
+        profile.Build(map, MapVersion(map), id);
+
+        for (int query = 0; query < 25; query++, total++)
+        {
+            const Cell start = RandomCell(random);
+            const Cell goal = RandomCell(random);
+            const int size = 1 + query % 2;
+            const vector<Cell> path = FindPath(start, goal, profile, manhattan, nullptr, nullptr, size);
+            const float expected = ReferenceCost(start, goal, map, id, manhattan, size);
+            const float cost = path.empty() ? FLT_MAX : PathCost(path, ProfileEnterCost(profile, size), manhattan);
+            costMismatches += expected == FLT_MAX ? !path.empty() : !SameCost(cost, expected);
+
+            vector<Cell> goals;
+            for (int i = 0; i < 1 + query % 12; i++)
+                goals.push_back(RandomCell(random));
+            float nearest = FLT_MAX;
+            for (const Cell& each : goals)
+                nearest = min(nearest, ReferenceCost(start, each, map, id, manhattan, 1));
+            const vector<Cell> nearestPath = FindPath(start, goals, profile, manhattan);
+            const float nearestCost = nearestPath.empty() ? FLT_MAX : PathCost(nearestPath, ProfileEnterCost(profile, 1), manhattan);
+            multiGoalMismatches += nearest == FLT_MAX ? !nearestPath.empty() : !SameCost(nearestCost, nearest);
+        }
+
+        // Paint some tiles, then compare the updated cache against one built from scratch
+        vector<Cell> changed;
+        for (int edit = 0; edit < 8; edit++)
+        {
+            const Cell cell = RandomCell(random);
+            map[cell.row][cell.col] = random() % COUNT;
+            changed.push_back(cell);
+        }
+        profile.Update(map, MapVersion(map), changed);
+        ProfileCache rebuilt;
+        rebuilt.Build(map, MapVersion(map), id);
+        updateMismatches += profile.tileCosts != rebuilt.tileCosts || profile.clearance.values != rebuilt.clearance.values;
+        for (int query = 0; query < 25; query++)
+        {
+            const Cell start = RandomCell(random);
+            const Cell goal = RandomCell(random);
+            updateMismatches += profile.Connected(start, goal) != rebuilt.Connected(start, goal);
+        }
+    }
+
+    int failed = 0;
+    failed += Report("Profile path cost matches Dijkstra", costMismatches, total);
+    failed += Report("Nearest of many goals matches Dijkstra", multiGoalMismatches, total);
+    failed += Report("Updated cache matches a rebuilt one", updateMismatches, 40 * 26);
+    return failed;
+}
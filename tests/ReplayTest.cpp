@@ -0,0 +1,71 @@
+#include "QueryLog.h"
+#include "Replay.h"
+#include "TestMaps.h"
+
+bool SameRequest(const PathRequest& a, const PathRequest& b)
+{
+    return a.start == b.start && a.goal == b.goal && a.manhattan == b.manhattan && a.useCpd == b.useCpd &&
+        a.useSubgoals == b.useSubgoals && a.shape == b.shape && a.smooth == b.smooth && a.agentSize == b.agentSize &&
+        a.profile == b.profile && a.weight == b.weight && a.anytime == b.anytime && a.nearest == b.nearest;
+}
+
+// A log of every kind of query, over a map that gets edited as it goes, reads back as it was written & replays with
+// every config that's meant to find optimal paths agreeing on their costs
+int main()
+{
+    const char* path = "replay_test.sqlg";
+    mt19937 random(28);
+    Map map = RandomMap(random, 15);
+    vector<Map> written;
+    vector<PathRequest> requests;
+    QueryLog log;
+    if (!log.Open(path))
+    {
+        printf("Couldn't write %s\n", path);
+        return 1;
+    }
+    for (int query = 0; query < 300; query++)
+    {
+        if (query % 40 == 39)
+        {
+            for (int edit = 0; edit < 5; edit++)
+            {
+                const Cell cell = RandomCell(random);
+                map[cell.row][cell.col] = random() % COUNT;
+            }
+        }
+
+        PathRequest request;
+        request.start = RandomCell(random);
+        request.goal = RandomCell(random);
+        request.manhattan = random() % 2 == 0;
+        request.profile = random() % PROFILE_COUNT;
+        request.agentSize = 1 + random() % 2;
+        request.shape = random() % 4 == 0 ? (random() % 2 == 0 ? THETA_PATH : LAZY_THETA_PATH) : GRID_PATH;
+        request.smooth = random() % 5 == 0;
+        request.useSubgoals = random() % 6 == 0;
+        request.useCpd = request.profile == STANDARD_PROFILE && request.agentSize == 1 && random() % 4 == 0;
+        request.anytime = random() % 6 == 0;
+        request.weight = random() % 4 == 0 ? 2.0f : 1.0f;
+        request.nearest = random() % 8 == 0 ? int(random() % MOUNTAIN) : -1;
+        log.Record(map, MapVersion(map), request);
+        if (written.empty() || written.back() != map)
+            written.push_back(map);
+        requests.push_back(request);
+    }
+    log.Close();
+
+    vector<Map> maps;
+    vector<LoggedQuery> queries;
+    int readMismatches = !LoadQueryLog(path, maps, queries) || maps != written || queries.size() != requests.size();
+    for (size_t i = 0; i < queries.size() && i < requests.size(); i++)
+        readMismatches += !SameRequest(queries[i].request, requests[i]);
+
+    const int replayed = Replay(path, {});
+    remove(path);
+
+    int failed = 0;
+    failed += Report("Query log reads back as written", readMismatches, (int)requests.size());
+    failed += Report("Replayed configs agree", replayed != 0, 1);
+    return failed;
+}
@@ -0,0 +1,60 @@
+#include "SubgoalGraph.h"
+#include "Search.h"
+#include "TestMaps.h"
+
+// Octile length of a path, or -1 if any step isn't one CanStep allows
+float StepLength(const vector<Cell>& path, const Map& map)
+{
+    float length = 0.0f;
+    for (size_t i = 1; i < path.size(); i++)
+    {
+        const Cell direction{ path[i].col - path[i - 1].col, path[i].row - path[i - 1].row };
+        if (abs(direction.col) > 1 || abs(direction.row) > 1 || !CanStep(map, path[i - 1], direction)) return -1.0f;
+        length += Octile(path[i - 1], path[i]);
+    }
+    return length;
+}
+
+// Subgoal graph paths are as short as grid A*'s over the same passability: every tile air but the mountains, & a size 1
+// clearance map so diagonals don't cut corners
+int main()
+{
+    mt19937 random(30);
+    int total = 0;
+    int lengthMismatches = 0;
+    int invalidPaths = 0;
+    for (int trial = 0; trial < 40; trial++)
+    {
+        Map map = RandomMap(random, 15 + trial % 4 * 10);
+        for (auto& row : map)
+        {
+            for (size_t& tile : row)
+                tile = tile == MOUNTAIN ? MOUNTAIN : AIR;
+        }
+        ClearanceMap clearance;
+        clearance.Build(map);
+        const SubgoalGraph graph = BuildSubgoalGraph(map, MapVersion(map));
+
+        for (int query = 0; query < 25; query++, total++)
+        {
+            const Cell start = RandomCell(random);
+            const Cell goal = RandomCell(random);
+            const vector<Cell> path = FindPath(start, goal, map, graph);
+            const vector<Cell> expected = FindPath(start, goal, map, false, nullptr, nullptr, &clearance, 1);
+            if (path.empty() || expected.empty())
+            {
+                lengthMismatches += path.empty() != expected.empty();
+                continue;
+            }
+
+            const float length = StepLength(path, map);
+            invalidPaths += length < 0.0f || !(path.front() == start) || !(path.back() == goal);
+            lengthMismatches += length >= 0.0f && !SameCost(length, StepLength(expected, map));
+        }
+    }
+
+    int failed = 0;
+    failed += Report("Subgoal path length matches A*", lengthMismatches, total);
+    failed += Report("Subgoal paths only take allowed steps", invalidPaths, total);
+    return failed;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include "Grid.h"
+#include <random>
+#include <cstdio>
+
+// Random maps & queries for the regression tests, from fixed seeds so any failure reproduces
+
+// Every tile a random type, mountains making up about mountainPercent of them
+inline Map RandomMap(mt19937& random, int mountainPercent)
+{
+    Map map;
+    for (auto& row : map)
+    {
+        for (size_t& tile : row)
+            tile = int(random() % 100) < mountainPercent ? MOUNTAIN : random() % MOUNTAIN;
+    }
+    return map;
+}
+
+inline Cell RandomCell(mt19937& random)
+{
+    return { int(random() % TILE_COUNT), int(random() % TILE_COUNT) };
+}
+
+// Costs within rounding of each other, relative to their size
+inline bool SameCost(float a, float b)
+{
+    return fabs(a - b) <= 1e-3f * max(1.0f, fabs(a));
+}
+
+// Prints how a check went & returns 1 if anything failed, for main to add up into its exit code
+inline int Report(const char* check, int failures, int total)
+{
+    printf("%-40s %s (%i/%i failed)\n", check, failures == 0 ? "ok" : "FAILED", failures, total);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+#include "Wavefront.h"
+#include "TestMaps.h"
+
+// Random grid of any size, mountains making up about mountainPercent of it & the rest air
+TileGrid RandomGrid(mt19937& random, int width, int height, int mountainPercent)
+{
+    TileGrid grid;
+    grid.width = width;
+    grid.height = height;
+    grid.tiles.resize(size_t(width) * height);
+    for (uint8_t& tile : grid.tiles)
+        tile = int(random() % 100) < mountainPercent ? MOUNTAIN : AIR;
+    return grid;
+}
+
+TileBits Passable(const TileGrid& grid)
+{
+    TileBits passable(grid.width, grid.height);
+    for (size_t index = 0; index < grid.tiles.size(); index++)
+    {
+        if (grid.tiles[index] != MOUNTAIN)
+            passable.Set(grid.CellOf(index));
+    }
+    return passable;
+}
+
+// Whether a path from the wavefront's start to goal steps between neighbouring passable tiles & is as short as the BFS says
+bool ValidPath(const vector<Cell>& path, const TileGrid& grid, Cell start, Cell goal, const vector<uint32_t>& bfs)
+{
+    if (bfs[grid.Index(goal)] == UINT32_MAX) return path.empty();
+    if (path.size() != bfs[grid.Index(goal)] + 1 || !(path.front() == start) || !(path.back() == goal)) return false;
+    for (size_t i = 1; i < path.size(); i++)
+    {
+        if (abs(path[i].col - path[i - 1].col) > 1 || abs(path[i].row - path[i - 1].row) > 1) return false;
+        if (grid.tiles[grid.Index(path[i])] == MOUNTAIN) return false;
+    }
+    return true;
+}
+
+// Wavefront fields & paths match a node-by-node BFS, on the app's maps & on grids whose rows don't fill whole words
+int main()
+{
+    mt19937 random(49);
+    int total = 0;
+    int fieldMismatches = 0;
+    int pathMismatches = 0;
+    int earlyStopMismatches = 0;
+
+    vector<TileGrid> grids;
+    for (int trial = 0; trial < 20; trial++)
+        grids.push_back(TileGrid(RandomMap(random, 30)));
+    grids.push_back(RandomGrid(random, 300, 37, 30));
+    grids.push_back(RandomGrid(random, 64, 64, 40));
+    grids.push_back(RandomGrid(random, 1, 90, 10));
+
+    Wavefront wavefront;
+    vector<uint32_t> bfs;
+    for (const TileGrid& grid : grids)
+    {
+        const TileBits passable = Passable(grid);
+        for (int query = 0; query < 20; query++, total++)
+        {
+            const Cell start = grid.CellOf(random() % grid.tiles.size());
+            const Cell goal = grid.CellOf(random() % grid.tiles.size());
+            QueueBfs(grid, start, { -1, -1 }, bfs);
+
+            wavefront.Run(passable, start, true);
+            fieldMismatches += wavefront.distances != bfs;
+            pathMismatches += !ValidPath(wavefront.PathTo(goal), grid, start, goal, bfs);
+
+            wavefront.Run(passable, start, true, goal);
+            earlyStopMismatches += wavefront.Distance(goal) != bfs[grid.Index(goal)];
+        }
+    }
+
+    int failed = 0;
+    failed += Report("Wavefront field matches BFS", fieldMismatches, total);
+    failed += Report("Wavefront path is a shortest BFS path", pathMismatches, total);
+    failed += Report("Wavefront stopping at the goal", earlyStopMismatches, total);
+    return failed;
+}